@@ -0,0 +1,158 @@
+# End-to-end benchmarks of the NIFs on synthetic datasets, including
+# the cost of converting Elixir data. Each measurement is printed as
+# one JSON object per line, for regression tracking:
+#
+#     mix run bench/scitree_bench.exs -- --rows 1000,10000 --output bench.jsonl
+#
+# The native code paths alone are measured by `make bench`.
+
+defmodule Scitree.Bench do
+  @defaults [
+    rows: "1000,10000,100000",
+    columns: "10,100",
+    mixes: "numerical,categorical,string,mixed",
+    learners: "cart,random_forest,gradient_boosted_trees",
+    batch_sizes: "1,16,256,4096",
+    predictions: 200,
+    output: nil
+  ]
+
+  def run(argv) do
+    {opts, _, _} =
+      OptionParser.parse(argv,
+        strict: [
+          rows: :string,
+          columns: :string,
+          mixes: :string,
+          learners: :string,
+          batch_sizes: :string,
+          predictions: :integer,
+          output: :string
+        ]
+      )
+
+    opts = Keyword.merge(@defaults, opts)
+    device = if opts[:output], do: File.open!(opts[:output], [:write]), else: :stdio
+
+    for mix <- list(opts[:mixes]),
+        rows <- list(opts[:rows], &String.to_integer/1),
+        columns <- list(opts[:columns], &String.to_integer/1) do
+      data = dataset(mix, rows, columns)
+      info = %{mix: mix, rows: rows, columns: columns}
+
+      for learner <- list(opts[:learners], &String.to_atom/1) do
+        config =
+          Scitree.Config.init()
+          |> Scitree.Config.label("label")
+          |> Scitree.Config.learner(learner)
+
+        {micros, ref} = :timer.tc(fn -> Scitree.train(config, data) end)
+        emit(device, "training", Map.merge(info, %{learner: learner, seconds: micros / 1.0e6}))
+
+        features = Map.delete(data, "label")
+        Scitree.warmup(ref)
+
+        for batch_size <- list(opts[:batch_sizes], &String.to_integer/1) do
+          batch_size = min(batch_size, rows)
+          batches = batches(features, rows, batch_size, opts[:predictions])
+          info = Map.merge(info, %{learner: learner, batch_size: batch_size})
+
+          results = measure(batches, &Scitree.predict(ref, &1))
+          emit(device, "predict", Map.merge(info, results))
+
+          binding = Scitree.bind(ref, Map.keys(features))
+          columns = Enum.map(batches, &Map.values/1)
+          results = measure(columns, &Scitree.predict(binding, &1))
+          emit(device, "predict_bound", Map.merge(info, results))
+
+          if batch_size == 1 do
+            examples = Enum.map(batches, &Map.new(&1, fn {k, [v]} -> {k, v} end))
+            results = measure(examples, &Scitree.predict_one(ref, &1))
+            emit(device, "predict_one", Map.merge(info, results))
+          end
+        end
+      end
+    end
+
+    if opts[:output], do: File.close(device)
+  end
+
+  defp list(value, fun \\ & &1) do
+    value |> String.split(",", trim: true) |> Enum.map(fun)
+  end
+
+  # Features of the given mix of types, and a binary label that
+  # depends on the first features so the learners have something
+  # to fit.
+  defp dataset(mix, rows, columns) do
+    :rand.seed(:exsss, {1, 2, 3})
+
+    features =
+      for col <- 0..(columns - 1), into: %{} do
+        type =
+          if mix == "mixed",
+            do: Enum.at(["numerical", "categorical", "string"], rem(col, 3)),
+            else: mix
+
+        {"f#{col}", column(type, rows)}
+      end
+
+    label =
+      0..(rows - 1)
+      |> Enum.map(fn i ->
+        score =
+          for col <- 0..min(3, columns - 1), reduce: 0.0 do
+            acc -> acc + signal(Enum.at(features["f#{col}"], i))
+          end
+
+        if score + :rand.normal() * 0.5 > 0, do: 2, else: 1
+      end)
+
+    Map.put(features, "label", label)
+  end
+
+  defp column("numerical", rows), do: for(_ <- 1..rows, do: :rand.normal())
+  defp column("categorical", rows), do: for(_ <- 1..rows, do: :rand.uniform(32))
+  defp column("string", rows), do: for(_ <- 1..rows, do: "w#{:rand.uniform(1000)}")
+
+  defp signal(value) when is_float(value), do: value
+  defp signal(value) when is_integer(value), do: if(rem(value, 2) == 1, do: 1, else: -1)
+  defp signal("w" <> n), do: signal(String.to_integer(n))
+
+  defp batches(features, rows, batch_size, count) do
+    for p <- 0..(count - 1) do
+      start = rem(p * batch_size, rows - batch_size + 1)
+      Map.new(features, fn {name, values} -> {name, Enum.slice(values, start, batch_size)} end)
+    end
+  end
+
+  defp measure(inputs, fun) do
+    latencies = for input <- inputs, do: elem(:timer.tc(fn -> fun.(input) end), 0)
+    sorted = Enum.sort(latencies)
+    count = length(sorted)
+    percentile = fn q -> Enum.at(sorted, min(count - 1, trunc(q * count))) end
+
+    %{
+      p50_us: percentile.(0.5),
+      p90_us: percentile.(0.9),
+      p99_us: percentile.(0.99),
+      calls_per_second: count / (Enum.sum(latencies) / 1.0e6)
+    }
+  end
+
+  defp emit(device, benchmark, fields) do
+    fields = Map.put(fields, :benchmark, benchmark)
+
+    json =
+      fields
+      |> Enum.sort()
+      |> Enum.map_join(",", fn {key, value} -> ~s("#{key}":#{encode(value)}) end)
+
+    IO.puts(device, "{" <> json <> "}")
+  end
+
+  defp encode(value) when is_number(value), do: to_string(value)
+  defp encode(value), do: ~s("#{value}")
+end
+
+Scitree.Bench.run(System.argv())
@@ -1,6 +1,17 @@
+#include "./scitree_compact.hpp"
+#include "./scitree_concurrency.hpp"
+#include "./scitree_cpu.hpp"
 #include "./scitree_dataset.hpp"
+#include "./scitree_evaluation.hpp"
 #include "./scitree_learner.hpp"
 #include "./scitree_nif_helper.hpp"
+#include "./scitree_predict.hpp"
+#include "./scitree_resource.hpp"
+#include "./scitree_serialize.hpp"
+#include "./scitree_server.hpp"
+#include "./scitree_stats.hpp"
+#include "./scitree_tuner.hpp"
+#include "./scitree_warmstart.hpp"
 
 #include "yggdrasil_decision_forests/dataset/data_spec.h"
 #include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
@@ -9,13 +20,34 @@
 #include "yggdrasil_decision_forests/model/model_library.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstring>
 #include <erl_nif.h>
 #include <map>
+#include <thread>
 #include <vector>
 
 ErlNifResourceType *RES_TYPE;
+ErlNifResourceType *PREDICTOR_RES_TYPE;
+ErlNifResourceType *SERVER_RES_TYPE;
+ErlNifResourceType *BINDING_RES_TYPE;
+ErlNifResourceType *DATASET_RES_TYPE;
+
+// Native workers used for dataset ingestion and sharded predictions.
+// The size comes from the load info of the NIF (0 means one per
+// hardware thread).
+static scitree::concurrency::SCITREE_POOL POOL;
+
+// Workers running the trainings of train_async, at most
+// ASYNC_TRAININGS at once, the others waiting in its queue. Each
+// training gets its share of the hardware threads unless its config
+// sets them. Unloading the library waits for the trainings.
+static scitree::concurrency::SCITREE_POOL TRAINING_POOL;
+static const int ASYNC_TRAININGS = 2;
+
+// Number of rows above which predict leaves the normal scheduler.
+static const unsigned int DIRTY_PREDICT_ROWS = 1000;
 
 namespace ygg = yggdrasil_decision_forests;
 
@@ -24,21 +56,57 @@ static int open_resource(ErlNifEnv *env) {
   const char *name = "yggdrasil";
   int flags = ERL_NIF_RT_CREATE | ERL_NIF_RT_TAKEOVER;
 
-  RES_TYPE = enif_open_resource_type(env, mod, name, NULL, (ErlNifResourceFlags)flags, NULL);
+  RES_TYPE = enif_open_resource_type(env, mod, name, scitree::resource::free_model,
+                                     (ErlNifResourceFlags)flags, NULL);
   if (RES_TYPE == NULL)
     return -1;
+
+  PREDICTOR_RES_TYPE = enif_open_resource_type(env, mod, "predictor", scitree::resource::free_predictor,
+                                               (ErlNifResourceFlags)flags, NULL);
+  if (PREDICTOR_RES_TYPE == NULL)
+    return -1;
+
+  SERVER_RES_TYPE = enif_open_resource_type(env, mod, "server", scitree::server::free_server,
+                                            (ErlNifResourceFlags)flags, NULL);
+  if (SERVER_RES_TYPE == NULL)
+    return -1;
+
+  BINDING_RES_TYPE = enif_open_resource_type(env, mod, "binding", scitree::resource::free_binding,
+                                             (ErlNifResourceFlags)flags, NULL);
+  if (BINDING_RES_TYPE == NULL)
+    return -1;
+
+  DATASET_RES_TYPE = enif_open_resource_type(env, mod, "dataset", scitree::resource::free_dataset,
+                                             (ErlNifResourceFlags)flags, NULL);
+  if (DATASET_RES_TYPE == NULL)
+    return -1;
   return 0;
 }
 
 static int load(ErlNifEnv *env, void **priv, ERL_NIF_TERM load_info)
 {
   absl::SetFlag(&FLAGS_alsologtostderr, false);
+  if (!scitree::cpu::supports_compiled_isa())
+    return -1;
+
   if (open_resource(env) == -1)
     return -1;
 
+  int num_threads = 0;
+  enif_get_int(env, load_info, &num_threads);
+  scitree::concurrency::start_pool(&POOL, num_threads);
+  scitree::concurrency::start_pool(&TRAINING_POOL, ASYNC_TRAININGS);
+
   return 0;
 }
 
+static void unload(ErlNifEnv *env, void *priv)
+{
+  scitree::server::join_stopped(true);
+  scitree::concurrency::stop_pool(&TRAINING_POOL);
+  scitree::concurrency::stop_pool(&POOL);
+}
+
 static int reload(ErlNifEnv *env, void **priv, ERL_NIF_TERM load_info)
 {
   absl::SetFlag(&FLAGS_alsologtostderr, false);
@@ -48,205 +116,1365 @@ static int reload(ErlNifEnv *env, void **priv, ERL_NIF_TERM load_info)
   return 0;
 }
 
-static ERL_NIF_TERM train(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+static ERL_NIF_TERM make_model_resource(ErlNifEnv *env, std::unique_ptr<ygg::model::AbstractModel> model)
 {
-  scitree::nif::SCITREE_CONFIG config = scitree::nif::make_scitree_config(env, argv[0]);
+  if (model == nullptr)
+    return scitree::nif::error(env, "Unable to open resource.");
 
-  if (config.error.status)
-  {
-    return scitree::nif::error(env, config.error.reason.c_str());
-  }
+  scitree::resource::SCITREE_MODEL *p_model =
+      scitree::resource::alloc_model(RES_TYPE, std::move(model));
 
+  if (p_model == NULL)
+    return scitree::nif::error(env, "Unable to open resource.");
+
+  ERL_NIF_TERM resource = enif_make_resource(env, p_model);
+  enif_release_resource(p_model);
+
+  return enif_make_tuple2(env, scitree::nif::ok(env), resource);
+}
+
+// Decodes a dataset given as columns and ingests it with a dataspec
+// inferred from its values.
+static scitree::nif::SCITREE_ERROR ingest(
+  ErlNifEnv *env, ERL_NIF_TERM term,
+  ygg::dataset::VerticalDataset *dataset)
+{
+  scitree::nif::SCITREE_ERROR error;
   std::vector<ERL_NIF_TERM> nif_dataset;
 
-  if (!scitree::nif::get_list(env, argv[1], nif_dataset))
+  if (!scitree::nif::get_list(env, term, nif_dataset))
   {
-    return scitree::nif::error(env, "Empty or invalid dataset.");
+    error.status = true;
+    error.reason = "Empty or invalid dataset.";
+    return error;
+  }
+
+  std::vector<scitree::dataset::SCITREE_COLUMN> columns;
+  error = scitree::dataset::decode_columns(env, nif_dataset.data(), nif_dataset.size(), &columns);
+  if (error.status)
+  {
+    return error;
   }
-  // Training configuration
-  ygg::model::proto::TrainingConfig train_config;
-  train_config.set_learner(config.learner);
-  train_config.set_task(config.task);
-  train_config.set_label(config.label);
-  
+
   // Create types dataspec
   ygg::dataset::proto::DataSpecification spec;
-  ygg::dataset::VerticalDataset dataset;
 
-  auto error_spec = scitree::dataset::load_data_spec(&spec, env, nif_dataset.data(), nif_dataset.size());
-  if (error_spec.status)
+  error = scitree::dataset::load_data_spec(&spec, columns);
+  if (error.status)
+  {
+    return error;
+  }
+
+  return scitree::dataset::load_dataset(dataset, spec, &columns, true, &POOL);
+}
+
+// Decodes the config and dataset of a train call. A dataset handle
+// is trained on as is, kept alive until the returned pointer is
+// released.
+static scitree::nif::SCITREE_ERROR load_training(
+  ErlNifEnv *env, const ERL_NIF_TERM argv[],
+  scitree::nif::SCITREE_CONFIG *config,
+  std::shared_ptr<const ygg::dataset::VerticalDataset> *dataset)
+{
+  *config = scitree::nif::make_scitree_config(env, argv[0]);
+
+  if (config->error.status)
+  {
+    return config->error;
+  }
+
+  scitree::resource::SCITREE_DATASET *p_dataset;
+
+  if (enif_get_resource(env, argv[1], DATASET_RES_TYPE, (void **)&p_dataset))
   {
-    return scitree::nif::error(env, error_spec.reason.c_str());
+    enif_keep_resource(p_dataset);
+    dataset->reset(&p_dataset->dataset, [p_dataset](const ygg::dataset::VerticalDataset *) {
+      enif_release_resource(p_dataset);
+    });
+    return scitree::nif::SCITREE_ERROR();
   }
 
-  auto error_dataset = scitree::dataset::load_dataset(&dataset, &spec, env, nif_dataset.data(), nif_dataset.size());
+  auto ingested = std::make_shared<ygg::dataset::VerticalDataset>();
+  auto error = ingest(env, argv[1], ingested.get());
+  *dataset = std::move(ingested);
+
+  return error;
+}
+
+static ERL_NIF_TERM train(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  scitree::nif::SCITREE_CONFIG config;
+  std::shared_ptr<const ygg::dataset::VerticalDataset> dataset;
+
+  auto error_dataset = load_training(env, argv, &config, &dataset);
   if (error_dataset.status)
   {
     return scitree::nif::error(env, error_dataset.reason.c_str());
   }
 
-  // Config learner
-  std::unique_ptr<ygg::model::AbstractLearner> learner;
-  GetLearner(train_config, &learner);
+  std::unique_ptr<ygg::model::AbstractModel> model;
+  auto error_train = scitree::learner::train(config, *dataset, &model);
+  if (error_train.status)
+  {
+    return scitree::nif::error(env, error_train.reason.c_str());
+  }
 
-  if (config.log_directory.length() > 0)
-    learner->set_log_directory(config.log_directory);
+  return make_model_resource(env, std::move(model));
+}
 
-  // Define options
-  learner->SetHyperParameters(scitree::learner::get_hyper_params(config.options));
+// Ingests a dataset once into a handle that train, predict and
+// evaluate accept in place of the columns.
+static ERL_NIF_TERM dataset_new(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  scitree::resource::SCITREE_DATASET *p_dataset = scitree::resource::alloc_dataset(DATASET_RES_TYPE);
 
-  auto model = learner->TrainWithStatus(dataset).value();
+  if (p_dataset == NULL)
+    return scitree::nif::error(env, "Unable to open resource.");
 
-  // prepare resource
-  ygg::model::AbstractModel **p_model;
-  p_model = (ygg::model::AbstractModel **)enif_alloc_resource(RES_TYPE, sizeof(ygg::model::AbstractModel *));
+  ERL_NIF_TERM resource = enif_make_resource(env, p_dataset);
+  enif_release_resource(p_dataset);
 
-  *p_model = model.release();
+  auto error = ingest(env, argv[0], &p_dataset->dataset);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
 
-  if (*p_model == NULL)
-    return scitree::nif::error(env, "Unable to open resource.");
+  return enif_make_tuple3(env, scitree::nif::ok(env), resource,
+                          enif_make_int64(env, p_dataset->dataset.nrow()));
+}
 
-  ERL_NIF_TERM resource = enif_make_resource(env, p_model);
+// Searches the hyper-parameters of argv[2] ({name, [value]} list)
+// with at most argv[3] trials, trained concurrently on threads of
+// their own. The trials share the dataset (argv[1], columns or
+// handle), split once between training rows and argv[4] of
+// validation rows. argv[5] is
+// the time budget of a trial in seconds, or a non-positive number.
+// Returns the best model and the score table of the trials.
+static ERL_NIF_TERM tune(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  scitree::nif::SCITREE_CONFIG config;
+  std::shared_ptr<const ygg::dataset::VerticalDataset> dataset;
+  int num_trials;
+  double validation_ratio, max_trial_seconds;
 
-  return enif_make_tuple2(env, scitree::nif::ok(env), resource);
+  if (!enif_get_int(env, argv[3], &num_trials) || num_trials <= 0)
+  {
+    return scitree::nif::error(env, "Invalid number of trials.");
+  }
+
+  if (!enif_get_double(env, argv[4], &validation_ratio) ||
+      !enif_get_double(env, argv[5], &max_trial_seconds))
+  {
+    return scitree::nif::error(env, "Invalid tuning options.");
+  }
+
+  std::vector<scitree::tuner::SCITREE_SEARCH_SPACE> space;
+  auto error = scitree::tuner::get_search_space(env, argv[2], &space);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  error = load_training(env, argv, &config, &dataset);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  ygg::dataset::VerticalDataset train, validation;
+  error = scitree::tuner::split_dataset(*dataset, validation_ratio, config.options.random_seed,
+                                        &train, &validation);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+  dataset.reset();
+
+  auto trials = scitree::tuner::make_trials(space, num_trials, config.options.random_seed);
+  size_t best;
+  error = scitree::tuner::tune(config, train, validation, max_trial_seconds, &trials, &best);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  ERL_NIF_TERM table = scitree::tuner::make_score_table(env, trials);
+  ERL_NIF_TERM model = make_model_resource(env, std::move(trials[best].model));
+
+  return enif_make_tuple3(env, scitree::nif::ok(env), model, table);
 }
 
-static ERL_NIF_TERM predict(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+// Trains on a dataset file read by yggdrasil, without loading the
+// data in the VM. Column types are inferred from the file, except
+// for the ones given in argv[2] and for the label of classification
+// tasks which is always categorical.
+static ERL_NIF_TERM train_from_path(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
 {
-  ygg::model::AbstractModel **p_model;
+  scitree::nif::SCITREE_CONFIG config = scitree::nif::make_scitree_config(env, argv[0]);
 
-  if (!enif_get_resource(env, argv[0], RES_TYPE, (void **)&p_model))
+  if (config.error.status)
   {
-    return scitree::nif::error(env, "Unable to load model.");
+    return scitree::nif::error(env, config.error.reason.c_str());
   }
 
-  std::vector<ERL_NIF_TERM> dataset;
+  std::string path;
 
-  if (!scitree::nif::get_list(env, argv[1], dataset))
+  if (!scitree::nif::get(env, argv[1], path))
   {
-    return scitree::nif::error(env, "Empty or invalid dataset.");
+    return scitree::nif::error(env, "Unable to get path.");
   }
 
+  ygg::dataset::proto::DataSpecificationGuide guide;
+  auto error = scitree::dataset::load_guide(env, argv[2], &guide);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
 
-  // Create types dataspec
-  ygg::dataset::VerticalDataset dataset_predict;
-  ygg::dataset::proto::DataSpecification spec = (**p_model).data_spec();
+  if (config.task == ygg::model::proto::Task::CLASSIFICATION)
+  {
+    scitree::dataset::add_column_guide(&guide, config.label, ygg::dataset::proto::ColumnType::CATEGORICAL);
+  }
+
+  ygg::dataset::proto::DataSpecification spec;
+  error = scitree::dataset::infer_data_spec(path, guide, &spec);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  std::unique_ptr<ygg::model::AbstractModel> model;
+  error = scitree::learner::train_from_path(config, path, spec, &model);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
 
-  // Load dataset
-  auto error_dataset = scitree::dataset::load_dataset(&dataset_predict, &spec, env, dataset.data(), dataset.size());
+  return make_model_resource(env, std::move(model));
+}
+
+// Decodes the dataset on the (dirty) scheduler and trains on
+// TRAINING_POOL. The caller receives {scitree_done, Ref, Result} once
+// the training is over, where Result has the same shape as train/2.
+static ERL_NIF_TERM train_async(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  auto config = std::make_shared<scitree::nif::SCITREE_CONFIG>();
+  std::shared_ptr<const ygg::dataset::VerticalDataset> dataset;
+
+  auto error_dataset = load_training(env, argv, config.get(), &dataset);
   if (error_dataset.status)
   {
     return scitree::nif::error(env, error_dataset.reason.c_str());
   }
 
-  // Will compile the model into the most efficient engine
-  // on the current hardware.
-  const std::unique_ptr<ygg::serving::FastEngine> serving_engine =
-      (**p_model).BuildFastEngine().value();
-  const auto &features = serving_engine->features();
+  if (config->num_threads <= 0)
+  {
+    const int hardware = std::max(1u, std::thread::hardware_concurrency());
+    config->num_threads = std::max(1, hardware / ASYNC_TRAININGS);
+  }
 
-  int num_row = dataset_predict.nrow();
-  std::unique_ptr<ygg::serving::AbstractExampleSet> examples =
-      serving_engine->AllocateExamples(num_row);
+  ErlNifPid pid;
+  enif_self(env, &pid);
 
-  ygg::serving::CopyVerticalDatasetToAbstractExampleSet(
-      dataset_predict, 0, num_row - 1, features, examples.get());
-  
-  std::vector<float> batch_of_predictions;
-  serving_engine->Predict(*examples, num_row, &batch_of_predictions);
-  const int batch_size = batch_of_predictions.size();
-  const int qtt_category_types = batch_size / num_row;
+  ErlNifEnv *msg_env = enif_alloc_env();
+  ERL_NIF_TERM ref = enif_make_copy(msg_env, argv[2]);
 
-  ERL_NIF_TERM *predictions = new ERL_NIF_TERM[batch_size];
+  scitree::concurrency::schedule(&TRAINING_POOL, [config, dataset, pid, msg_env, ref]() mutable {
+    std::unique_ptr<ygg::model::AbstractModel> model;
+    auto error_train = scitree::learner::train(*config, *dataset, &model);
+    dataset.reset();
+
+    ERL_NIF_TERM result = error_train.status
+                              ? scitree::nif::error(msg_env, error_train.reason.c_str())
+                              : make_model_resource(msg_env, std::move(model));
+
+    ERL_NIF_TERM msg = enif_make_tuple3(
+        msg_env, enif_make_atom(msg_env, "scitree_done"), ref, result);
+
+    enif_send(NULL, &pid, msg_env, msg);
+    enif_free_env(msg_env);
+  });
+
+  return scitree::nif::ok(env);
+}
+
+// Loads the dataset of a predict or evaluate call in the dataspec of
+// the model. A dataset handle is read as is when it has the encoding
+// of the model (e.g. the model was trained on it) and re-encoded
+// otherwise; `dataset` then points either to the handle or to
+// `storage`. When `label` is set, the dataset must hold the label
+// column of the model.
+static scitree::nif::SCITREE_ERROR load_model_dataset(
+  ErlNifEnv *env, ERL_NIF_TERM term,
+  const scitree::resource::SCITREE_MODEL &model, bool label,
+  ygg::dataset::VerticalDataset *storage,
+  const ygg::dataset::VerticalDataset **dataset)
+{
+  scitree::nif::SCITREE_ERROR error;
+  const auto &data_spec = model.model->data_spec();
+  const std::string &label_name = data_spec.columns(model.model->label_col_idx()).name();
+  scitree::resource::SCITREE_DATASET *p_dataset;
 
-  int i = 0;
-  for (size_t i = 0; i < batch_size; i++)
+  if (enif_get_resource(env, term, DATASET_RES_TYPE, (void **)&p_dataset))
   {
-    const float prediction = batch_of_predictions[i];
+    const auto &source = p_dataset->dataset;
 
-    if ((**p_model).task() == ygg::model::proto::Task::CLASSIFICATION)
+    if (label && ygg::dataset::GetColumnIdxFromName(label_name, source.data_spec()) < 0)
     {
-      float class_prediction = std::clamp(prediction, 0.f, 1.f);
-      predictions[i] = enif_make_double(env, class_prediction);
+      error.status = true;
+      error.reason = "The dataset has no label column " + label_name + ".";
+      return error;
     }
-    else
+
+    if (scitree::dataset::same_encoding(source, data_spec))
     {
-      predictions[i] = enif_make_double(env, prediction);
+      *dataset = &source;
+      return error;
     }
+
+    *dataset = storage;
+    return scitree::dataset::conform_dataset(source, data_spec, model.dictionaries, storage, &POOL);
+  }
+
+  std::vector<ERL_NIF_TERM> nif_dataset;
+
+  if (!scitree::nif::get_list(env, term, nif_dataset))
+  {
+    error.status = true;
+    error.reason = "Empty or invalid dataset.";
+    return error;
   }
 
-  ERL_NIF_TERM chunk = enif_make_int(env, qtt_category_types);
-  ERL_NIF_TERM list = enif_make_list_from_array(env, predictions, batch_size);
+  std::vector<scitree::dataset::SCITREE_COLUMN> columns;
+  error = scitree::dataset::decode_columns(env, nif_dataset.data(), nif_dataset.size(), &columns);
+  if (error.status)
+  {
+    return error;
+  }
 
-  // deallocate predictions array
-  delete[] predictions;
+  if (label && std::none_of(columns.begin(), columns.end(),
+                            [&label_name](const scitree::dataset::SCITREE_COLUMN &column) {
+                              return column.name == label_name;
+                            }))
+  {
+    error.status = true;
+    error.reason = "The dataset has no label column " + label_name + ".";
+    return error;
+  }
 
-  return enif_make_tuple3(env, scitree::nif::ok(env), list, chunk);
+  *dataset = storage;
+  return scitree::dataset::load_dataset(storage, data_spec, &columns, false, &POOL,
+                                        &model.dictionaries);
 }
 
-static ERL_NIF_TERM save(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[]) {
-  ygg::model::AbstractModel **p_model;
+static ERL_NIF_TERM predict_batch(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  scitree::resource::SCITREE_MODEL *p_model;
 
-  std::string path;
+  if (!enif_get_resource(env, argv[0], RES_TYPE, (void **)&p_model))
+  {
+    return scitree::nif::error(env, "Unable to load model.");
+  }
 
-  if (!scitree::nif::get(env, argv[1], path))
+  // Load dataset with the dataspec of the model
+  ygg::dataset::VerticalDataset storage;
+  const ygg::dataset::VerticalDataset *dataset_predict;
+  auto error_dataset = load_model_dataset(env, argv[1], *p_model, false, &storage, &dataset_predict);
+  if (error_dataset.status)
   {
-    return scitree::nif::error(env, "Unable to get path.");
+    return scitree::nif::error(env, error_dataset.reason.c_str());
+  }
+
+  // The engine is compiled once per model into the most
+  // efficient engine on the current hardware and then reused.
+  std::shared_ptr<const ygg::serving::FastEngine> serving_engine;
+  auto error_engine = scitree::resource::get_engine(p_model, &serving_engine);
+  if (error_engine.status)
+  {
+    return scitree::nif::error(env, error_engine.reason.c_str());
+  }
+
+  // Large batches are split into row shards scored by the workers.
+  std::vector<float> batch_of_predictions;
+  auto error_predict = scitree::predict::predict_dataset_sharded(
+      &POOL, *serving_engine, *dataset_predict, &batch_of_predictions);
+  if (error_predict.status)
+  {
+    return scitree::nif::error(env, error_predict.reason.c_str());
+  }
+
+  ERL_NIF_TERM binary = scitree::predict::make_predictions(env, p_model->model->task(), batch_of_predictions);
+  ERL_NIF_TERM chunk = enif_make_int(env, serving_engine->NumPredictionDimension());
+
+  return enif_make_tuple3(env, scitree::nif::ok(env), binary, chunk);
+}
+
+// Small batches are scored on the calling scheduler, larger
+// ones are rescheduled on a dirty CPU scheduler, as is the first
+// prediction of a model, which compiles its engine.
+static ERL_NIF_TERM predict(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  scitree::resource::SCITREE_MODEL *p_model;
+  scitree::resource::SCITREE_DATASET *p_dataset;
+  const int64_t num_row = enif_get_resource(env, argv[1], DATASET_RES_TYPE, (void **)&p_dataset)
+                              ? p_dataset->dataset.nrow()
+                              : scitree::dataset::count_rows(env, argv[1]);
+  const bool compiled = enif_get_resource(env, argv[0], RES_TYPE, (void **)&p_model) &&
+                        scitree::resource::serving_ready(p_model);
+
+  if (num_row > DIRTY_PREDICT_ROWS || !compiled)
+  {
+    return enif_schedule_nif(env, "predict", ERL_NIF_DIRTY_JOB_CPU_BOUND, predict_batch, argc, argv);
   }
 
+  return predict_batch(env, argc, argv);
+}
+
+// Scores argv[1] (columns or handle) with the first argv[2] trees of
+// the model (-1 for all), adding no more trees once argv[3]
+// microseconds (-1 for no budget) have passed since the call. Returns
+// the predictions with the number of trees used and the number of
+// trees the call would have used without budget.
+static ERL_NIF_TERM predict_trees_batch(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  const auto start = std::chrono::steady_clock::now();
+  scitree::resource::SCITREE_MODEL *p_model;
+  int max_trees;
+  ErlNifSInt64 budget_us;
+
   if (!enif_get_resource(env, argv[0], RES_TYPE, (void **)&p_model))
   {
-    return scitree::nif::error(env, "Unable to load resource.");
+    return scitree::nif::error(env, "Unable to load model.");
   }
 
-  SaveModel(path, *p_model);
+  if (!enif_get_int(env, argv[2], &max_trees) || max_trees == 0 || max_trees < -1)
+  {
+    return scitree::nif::error(env, "The number of trees must be positive.");
+  }
 
-  return scitree::nif::ok(env);
+  if (!enif_get_int64(env, argv[3], &budget_us) || budget_us == 0 || budget_us < -1)
+  {
+    return scitree::nif::error(env, "The time budget must be positive.");
+  }
+
+  const auto deadline = budget_us < 0 ? std::chrono::steady_clock::time_point::max()
+                                      : start + std::chrono::microseconds(budget_us);
+
+  ygg::dataset::VerticalDataset storage;
+  const ygg::dataset::VerticalDataset *dataset;
+  auto error = load_model_dataset(env, argv[1], *p_model, false, &storage, &dataset);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  std::shared_ptr<const scitree::flat::SCITREE_FLAT_ENGINE> engine;
+  error = scitree::resource::get_flat(p_model, &engine);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  std::vector<float> batch_of_predictions;
+  int trees_used;
+  error = scitree::predict::predict_dataset_truncated(*engine, *dataset, max_trees, deadline,
+                                                      &batch_of_predictions, &trees_used);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  ERL_NIF_TERM binary = scitree::predict::make_predictions(env, p_model->model->task(), batch_of_predictions);
+  ERL_NIF_TERM chunk = enif_make_int(env, engine->NumPredictionDimension());
+
+  ERL_NIF_TERM used = enif_make_int(env, trees_used);
+  ERL_NIF_TERM planned = enif_make_int(env, engine->NumTrees(max_trees));
+
+  return enif_make_tuple5(env, scitree::nif::ok(env), binary, chunk, used, planned);
 }
 
-static ERL_NIF_TERM load(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[]) {
-  std::string path;
+// Scheduled as predict, on a dirty scheduler when the flattened
+// forest of the model is not compiled yet.
+static ERL_NIF_TERM predict_trees(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  scitree::resource::SCITREE_MODEL *p_model;
+  scitree::resource::SCITREE_DATASET *p_dataset;
+  const int64_t num_row = enif_get_resource(env, argv[1], DATASET_RES_TYPE, (void **)&p_dataset)
+                              ? p_dataset->dataset.nrow()
+                              : scitree::dataset::count_rows(env, argv[1]);
+  const bool compiled = enif_get_resource(env, argv[0], RES_TYPE, (void **)&p_model) &&
+                        scitree::resource::flat_ready(p_model);
 
-  if (!scitree::nif::get(env, argv[0], path)) {
-    return scitree::nif::error(env, "Unable to get path.");
+  if (num_row > DIRTY_PREDICT_ROWS || !compiled)
+  {
+    return enif_schedule_nif(env, "predict_trees", ERL_NIF_DIRTY_JOB_CPU_BOUND, predict_trees_batch, argc, argv);
   }
 
-  std::unique_ptr<ygg::model::AbstractModel> model;
+  return predict_trees_batch(env, argc, argv);
+}
 
-  LoadModel(path, &model);
-  
-  // prepare resource
-  ygg::model::AbstractModel **p_model;
-  p_model = (ygg::model::AbstractModel **)enif_alloc_resource(RES_TYPE, sizeof(ygg::model::AbstractModel *));
+// Scores a single example given as a map of feature to value. The
+// row is written by feature index in a 1-row example set of the
+// engine, without building a dataset.
+static ERL_NIF_TERM predict_one_batch(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  scitree::resource::SCITREE_MODEL *p_model;
 
-  *p_model = model.release();
+  if (!enif_get_resource(env, argv[0], RES_TYPE, (void **)&p_model))
+  {
+    return scitree::nif::error(env, "Unable to load model.");
+  }
 
-  if (*p_model == NULL)
-    return scitree::nif::error(env, "Unable to open resource.");
+  std::shared_ptr<const scitree::resource::SCITREE_ENGINE> serving;
+  auto error = scitree::resource::get_serving(p_model, &serving);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
 
-  ERL_NIF_TERM resource = enif_make_resource(env, p_model);
+  const auto *serving_engine = serving->engine.get();
+  auto examples = scitree::resource::take_single(*serving);
 
-  return enif_make_tuple2(env, scitree::nif::ok(env), resource);
+  scitree::stats::SCITREE_TIMER write_timer(scitree::stats::WRITE_EXAMPLES);
+  error = scitree::examples::write_example(
+      env, argv[1], serving->features, *serving_engine, examples.get());
+  write_timer.stop();
+  if (error.status)
+  {
+    scitree::resource::give_single(*serving, std::move(examples));
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  std::vector<float> predictions;
+  scitree::stats::SCITREE_TIMER predict_timer(scitree::stats::PREDICT);
+  serving_engine->Predict(*examples, 1, &predictions);
+  predict_timer.stop();
+  scitree::stats::add(scitree::stats::ROWS_PREDICTED, 1);
+  scitree::resource::give_single(*serving, std::move(examples));
+
+  ERL_NIF_TERM binary = scitree::predict::make_predictions(env, p_model->model->task(), predictions);
+  ERL_NIF_TERM chunk = enif_make_int(env, serving_engine->NumPredictionDimension());
+
+  return enif_make_tuple3(env, scitree::nif::ok(env), binary, chunk);
 }
 
-static ERL_NIF_TERM show_dataspec(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[]) {
-  ygg::model::AbstractModel **p_model;
+// Scored on the calling scheduler once the engine of the model is
+// compiled, on a dirty scheduler before, as the call compiles it.
+static ERL_NIF_TERM predict_one(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  scitree::resource::SCITREE_MODEL *p_model;
 
-  if (!enif_get_resource(env, argv[0], RES_TYPE, (void **)&p_model)) {
-    return scitree::nif::error(env, "Unable to load resource.");
+  if (enif_get_resource(env, argv[0], RES_TYPE, (void **)&p_model) &&
+      !scitree::resource::serving_ready(p_model))
+  {
+    return enif_schedule_nif(env, "predict_one", ERL_NIF_DIRTY_JOB_CPU_BOUND, predict_one_batch, argc, argv);
   }
 
-  std::string data_spec = ygg::dataset::PrintHumanReadable((**p_model).data_spec(), false);
-  ERL_NIF_TERM spec_str = enif_make_string(env, data_spec.c_str(), ERL_NIF_LATIN1);
+  return predict_one_batch(env, argc, argv);
+}
 
-  return enif_make_tuple2(env, scitree::nif::ok(env), spec_str);
+// Resolves a list of column names once against the model. Returns
+// the binding and the type of each column, or ignored for the
+// columns that are not input features.
+static ERL_NIF_TERM bind_model(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  scitree::resource::SCITREE_MODEL *p_model;
+
+  if (!enif_get_resource(env, argv[0], RES_TYPE, (void **)&p_model))
+  {
+    return scitree::nif::error(env, "Unable to load model.");
+  }
+
+  std::vector<ERL_NIF_TERM> terms;
+
+  if (!scitree::nif::get_list(env, argv[1], terms))
+  {
+    return scitree::nif::error(env, "Empty or invalid column names.");
+  }
+
+  std::vector<std::string> names(terms.size());
+  for (size_t i = 0; i < terms.size(); i++)
+  {
+    if (!scitree::nif::get(env, terms[i], names[i]))
+    {
+      return scitree::nif::error(env, "Invalid column name.");
+    }
+  }
+
+  std::shared_ptr<const scitree::resource::SCITREE_ENGINE> serving;
+  auto error = scitree::resource::get_serving(p_model, &serving);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  // The binding points into the feature index of this engine, which
+  // its reference on the engine keeps alive.
+  std::shared_ptr<const ygg::serving::FastEngine> serving_engine(serving, serving->engine.get());
+  scitree::resource::SCITREE_BINDING *p_binding =
+      scitree::resource::alloc_binding(BINDING_RES_TYPE, p_model, std::move(serving_engine));
+
+  if (p_binding == NULL)
+    return scitree::nif::error(env, "Unable to open resource.");
+
+  ERL_NIF_TERM resource = enif_make_resource(env, p_binding);
+  enif_release_resource(p_binding);
+
+  error = scitree::resource::bind_columns(*p_model, serving->features, names, p_binding);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  std::vector<ERL_NIF_TERM> types;
+  for (size_t i = 0; i < names.size(); i++)
+  {
+    const char *type = p_binding->features[i] ? p_binding->columns[i].type.c_str() : "ignored";
+    types.push_back(enif_make_atom(env, type));
+  }
+
+  return enif_make_tuple3(env, scitree::nif::ok(env), resource,
+                          enif_make_list_from_array(env, types.data(), types.size()));
+}
+
+// Scores a dataset given as the list of the values of the bound
+// columns, in order. Rows are written by feature index into the
+// example set, without name lookups nor VerticalDataset.
+static ERL_NIF_TERM predict_bound_batch(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  scitree::resource::SCITREE_BINDING *p_binding;
+
+  if (!enif_get_resource(env, argv[0], BINDING_RES_TYPE, (void **)&p_binding))
+  {
+    return scitree::nif::error(env, "Unable to load binding.");
+  }
+
+  std::vector<ERL_NIF_TERM> values;
+
+  if (!scitree::nif::get_list(env, argv[1], values) || values.size() != p_binding->columns.size())
+  {
+    return scitree::nif::error(env, "Expected one list of values per bound column.");
+  }
+
+  const auto &engine = *p_binding->engine;
+  std::vector<scitree::dataset::SCITREE_COLUMN> columns(values.size());
+  int num_row = -1;
+
+  scitree::stats::SCITREE_TIMER decode_timer(scitree::stats::DECODE);
+
+  for (size_t i = 0; i < values.size(); i++)
+  {
+    if (p_binding->features[i] == nullptr)
+      continue;
+
+    auto &column = columns[i];
+    column.name = p_binding->columns[i].name;
+    column.type = p_binding->columns[i].type;
+    column.values = values[i];
+
+    auto error = scitree::dataset::get_values(env, &column);
+    if (!error.status)
+      error = scitree::dataset::decode_column(env, &column);
+    if (error.status)
+    {
+      return scitree::nif::error(env, error.reason.c_str());
+    }
+
+    if (num_row >= 0 && static_cast<int>(column.length) != num_row)
+    {
+      return scitree::nif::error(env, ("Column " + column.name + " has a different number of rows.").c_str());
+    }
+    num_row = column.length;
+  }
+
+  decode_timer.stop();
+
+  if (num_row < 0)
+  {
+    return scitree::nif::error(env, "No bound column is an input feature of the model.");
+  }
+
+  scitree::stats::add(scitree::stats::ROWS_DECODED, num_row);
+  scitree::stats::SCITREE_TIMER write_timer(scitree::stats::WRITE_EXAMPLES);
+
+  std::unique_ptr<ygg::serving::AbstractExampleSet> examples =
+      engine.AllocateExamples(std::max(num_row, 1));
+
+  for (size_t i = 0; i < columns.size(); i++)
+  {
+    if (p_binding->features[i] != nullptr)
+      scitree::examples::write_column(columns[i], *p_binding->features[i], engine.features(), examples.get(), 0);
+  }
+
+  for (const auto *feature : p_binding->missing)
+  {
+    scitree::examples::write_missing(*feature, engine.features(), examples.get(), 0, num_row);
+  }
+
+  write_timer.stop();
+
+  std::vector<float> batch_of_predictions;
+  scitree::stats::SCITREE_TIMER predict_timer(scitree::stats::PREDICT);
+  engine.Predict(*examples, num_row, &batch_of_predictions);
+  predict_timer.stop();
+  scitree::stats::add(scitree::stats::ROWS_PREDICTED, num_row);
+
+  ERL_NIF_TERM binary = scitree::predict::make_predictions(env, p_binding->model->model->task(), batch_of_predictions);
+  ERL_NIF_TERM chunk = enif_make_int(env, engine.NumPredictionDimension());
+
+  return enif_make_tuple3(env, scitree::nif::ok(env), binary, chunk);
+}
+
+static ERL_NIF_TERM predict_bound(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  ERL_NIF_TERM head, tail;
+  scitree::dataset::SCITREE_COLUMN column;
+  unsigned int num_row = 0;
+
+  if (enif_get_list_cell(env, argv[1], &head, &tail))
+  {
+    column.values = head;
+    if (!scitree::dataset::get_values(env, &column).status)
+      num_row = column.length;
+  }
+
+  if (num_row > DIRTY_PREDICT_ROWS)
+  {
+    return enif_schedule_nif(env, "predict_bound", ERL_NIF_DIRTY_JOB_CPU_BOUND, predict_bound_batch, argc, argv);
+  }
+
+  return predict_bound_batch(env, argc, argv);
+}
+
+static ERL_NIF_TERM predictor(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  scitree::resource::SCITREE_MODEL *p_model;
+  int capacity;
+
+  if (!enif_get_resource(env, argv[0], RES_TYPE, (void **)&p_model))
+  {
+    return scitree::nif::error(env, "Unable to load model.");
+  }
+
+  if (!enif_get_int(env, argv[1], &capacity) || capacity <= 0)
+  {
+    return scitree::nif::error(env, "Invalid chunk size.");
+  }
+
+  std::shared_ptr<const ygg::serving::FastEngine> serving_engine;
+  auto error_engine = scitree::resource::get_engine(p_model, &serving_engine);
+  if (error_engine.status)
+  {
+    return scitree::nif::error(env, error_engine.reason.c_str());
+  }
+
+  scitree::resource::SCITREE_PREDICTOR *p_predictor = scitree::resource::alloc_predictor(
+      PREDICTOR_RES_TYPE, p_model, std::move(serving_engine), capacity);
+
+  if (p_predictor == NULL)
+    return scitree::nif::error(env, "Unable to open resource.");
+
+  ERL_NIF_TERM resource = enif_make_resource(env, p_predictor);
+  enif_release_resource(p_predictor);
+
+  return enif_make_tuple2(env, scitree::nif::ok(env), resource);
+}
+
+// Scores one chunk of a stream with the example set of the predictor.
+// Chunks larger than the predictor capacity are scored by windows.
+static ERL_NIF_TERM predict_chunk_batch(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  scitree::resource::SCITREE_PREDICTOR *p_predictor;
+
+  if (!enif_get_resource(env, argv[0], PREDICTOR_RES_TYPE, (void **)&p_predictor))
+  {
+    return scitree::nif::error(env, "Unable to load predictor.");
+  }
+
+  std::vector<ERL_NIF_TERM> dataset;
+
+  if (!scitree::nif::get_list(env, argv[1], dataset))
+  {
+    return scitree::nif::error(env, "Empty or invalid dataset.");
+  }
+
+  const auto &model = *p_predictor->model->model;
+
+  std::vector<scitree::dataset::SCITREE_COLUMN> columns;
+  auto error_dataset = scitree::dataset::decode_columns(env, dataset.data(), dataset.size(), &columns);
+  if (error_dataset.status)
+  {
+    return scitree::nif::error(env, error_dataset.reason.c_str());
+  }
+
+  ygg::dataset::VerticalDataset dataset_predict;
+  error_dataset = scitree::dataset::load_dataset(&dataset_predict, model.data_spec(), &columns, false, &POOL,
+                                                &p_predictor->model->dictionaries);
+  if (error_dataset.status)
+  {
+    return scitree::nif::error(env, error_dataset.reason.c_str());
+  }
+
+  std::vector<float> batch_of_predictions;
+  {
+    // The example set is shared by the users of the predictor.
+    std::lock_guard<std::mutex> lock(p_predictor->mutex);
+    auto error_predict = scitree::predict::predict_dataset(
+        *p_predictor->engine, dataset_predict, p_predictor->examples.get(),
+        p_predictor->capacity, &batch_of_predictions);
+    if (error_predict.status)
+    {
+      return scitree::nif::error(env, error_predict.reason.c_str());
+    }
+  }
+
+  ERL_NIF_TERM binary = scitree::predict::make_predictions(env, model.task(), batch_of_predictions);
+  ERL_NIF_TERM chunk = enif_make_int(env, p_predictor->engine->NumPredictionDimension());
+
+  return enif_make_tuple3(env, scitree::nif::ok(env), binary, chunk);
+}
+
+static ERL_NIF_TERM predict_chunk(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  if (scitree::dataset::count_rows(env, argv[1]) > DIRTY_PREDICT_ROWS)
+  {
+    return enif_schedule_nif(env, "predict_chunk", ERL_NIF_DIRTY_JOB_CPU_BOUND, predict_chunk_batch, argc, argv);
+  }
+
+  return predict_chunk_batch(env, argc, argv);
+}
+
+// Starts a micro-batching server on the model. argv[1] is the
+// maximum number of rows scored together and argv[2] the time in
+// microseconds a request waits for others to join its batch.
+static ERL_NIF_TERM server_new(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  scitree::resource::SCITREE_MODEL *p_model;
+  int max_rows, window_us;
+
+  if (!enif_get_resource(env, argv[0], RES_TYPE, (void **)&p_model))
+  {
+    return scitree::nif::error(env, "Unable to load model.");
+  }
+
+  if (!enif_get_int(env, argv[1], &max_rows) || max_rows <= 0)
+  {
+    return scitree::nif::error(env, "Invalid maximum number of rows.");
+  }
+
+  if (!enif_get_int(env, argv[2], &window_us) || window_us < 0)
+  {
+    return scitree::nif::error(env, "Invalid batching window.");
+  }
+
+  std::shared_ptr<const scitree::resource::SCITREE_ENGINE> serving;
+  auto error_engine = scitree::resource::get_serving(p_model, &serving);
+  if (error_engine.status)
+  {
+    return scitree::nif::error(env, error_engine.reason.c_str());
+  }
+
+  scitree::server::SCITREE_SERVER *p_server = scitree::server::alloc_server(
+      SERVER_RES_TYPE, p_model, std::move(serving), max_rows, window_us);
+
+  if (p_server == NULL)
+    return scitree::nif::error(env, "Unable to open resource.");
+
+  ERL_NIF_TERM resource = enif_make_resource(env, p_server);
+  enif_release_resource(p_server);
+
+  return enif_make_tuple2(env, scitree::nif::ok(env), resource);
+}
+
+// Queues a dataset on the server. The caller receives
+// {scitree_prediction, Ref, Result} once its batch is scored,
+// where Result has the same shape as predict/2.
+static ERL_NIF_TERM server_submit(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  scitree::server::SCITREE_SERVER *p_server;
+
+  if (!enif_get_resource(env, argv[0], SERVER_RES_TYPE, (void **)&p_server))
+  {
+    return scitree::nif::error(env, "Unable to load server.");
+  }
+
+  auto error = scitree::server::submit(p_server, env, argv[1], argv[2]);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  return scitree::nif::ok(env);
+}
+
+// Scores a dataset file and writes the predictions to a csv file.
+static ERL_NIF_TERM predict_from_path(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  scitree::resource::SCITREE_MODEL *p_model;
+  std::string input_path, output_path;
+
+  if (!enif_get_resource(env, argv[0], RES_TYPE, (void **)&p_model))
+  {
+    return scitree::nif::error(env, "Unable to load model.");
+  }
+
+  if (!scitree::nif::get(env, argv[1], input_path) || !scitree::nif::get(env, argv[2], output_path))
+  {
+    return scitree::nif::error(env, "Unable to get path.");
+  }
+
+  const auto &model = *p_model->model;
+
+  ygg::dataset::VerticalDataset dataset_predict;
+  auto error = scitree::dataset::load_dataset_from_path(
+      input_path, model.data_spec(), model.input_features(), &dataset_predict);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  std::shared_ptr<const ygg::serving::FastEngine> serving_engine;
+  error = scitree::resource::get_engine(p_model, &serving_engine);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  std::vector<float> batch_of_predictions;
+  error = scitree::predict::predict_dataset_sharded(
+      &POOL, *serving_engine, dataset_predict, &batch_of_predictions);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  error = scitree::predict::write_predictions(
+      output_path, model, serving_engine->NumPredictionDimension(), batch_of_predictions);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  return enif_make_tuple2(env, scitree::nif::ok(env), enif_make_int64(env, dataset_predict.nrow()));
+}
+
+static ERL_NIF_TERM evaluate(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  scitree::resource::SCITREE_MODEL *p_model;
+  int bootstrapping_samples;
+
+  if (!enif_get_resource(env, argv[0], RES_TYPE, (void **)&p_model))
+  {
+    return scitree::nif::error(env, "Unable to load model.");
+  }
+
+  if (!enif_get_int(env, argv[2], &bootstrapping_samples))
+  {
+    return scitree::nif::error(env, "Invalid number of bootstrapping samples.");
+  }
+
+  const auto &model = *p_model->model;
+
+  auto error = scitree::resource::require_trees(*p_model);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  ygg::dataset::VerticalDataset storage;
+  const ygg::dataset::VerticalDataset *dataset_eval;
+  error = load_model_dataset(env, argv[1], *p_model, true, &storage, &dataset_eval);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  ERL_NIF_TERM metrics;
+  error = scitree::evaluation::evaluate(env, model, *dataset_eval, bootstrapping_samples, &metrics);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  return enif_make_tuple2(env, scitree::nif::ok(env), metrics);
+}
+
+// Adds up to argv[3] trees to the gradient boosted trees model of
+// argv[0], trained with the config of argv[1] on the dataset of
+// argv[2] (columns or handle) read in the dataspec of the model.
+// The model is left as is and the extended model is returned as a
+// new resource.
+static ERL_NIF_TERM continue_training(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  scitree::resource::SCITREE_MODEL *p_model;
+  int extra_trees;
+
+  if (!enif_get_resource(env, argv[0], RES_TYPE, (void **)&p_model))
+  {
+    return scitree::nif::error(env, "Unable to load model.");
+  }
+
+  if (!enif_get_int(env, argv[3], &extra_trees))
+  {
+    return scitree::nif::error(env, "Invalid number of extra trees.");
+  }
+
+  scitree::nif::SCITREE_CONFIG config = scitree::nif::make_scitree_config(env, argv[1]);
+  if (config.error.status)
+  {
+    return scitree::nif::error(env, config.error.reason.c_str());
+  }
+
+  auto error = scitree::resource::require_trees(*p_model);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  ygg::dataset::VerticalDataset storage;
+  const ygg::dataset::VerticalDataset *dataset;
+  error = load_model_dataset(env, argv[2], *p_model, true, &storage, &dataset);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  std::shared_ptr<const ygg::serving::FastEngine> engine;
+  error = scitree::resource::get_engine(p_model, &engine);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  std::unique_ptr<ygg::model::AbstractModel> model;
+  error = scitree::warmstart::continue_training(&POOL, config, *p_model->model, *engine,
+                                                *dataset, extra_trees, &model);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  return make_model_resource(env, std::move(model));
+}
+
+// Returns a copy of the model keeping its first argv[1] trees (-1
+// for all), with its values rounded to bfloat16 when argv[2] is true.
+// Quantized models are served by the flattened forest, which stores
+// them on 16 bits, and hold their trees nowhere else.
+static ERL_NIF_TERM compact(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  scitree::resource::SCITREE_MODEL *p_model;
+  int max_trees;
+  std::string quantize;
+
+  if (!enif_get_resource(env, argv[0], RES_TYPE, (void **)&p_model))
+  {
+    return scitree::nif::error(env, "Unable to load model.");
+  }
+
+  if (!enif_get_int(env, argv[1], &max_trees) || max_trees == 0 || max_trees < -1)
+  {
+    return scitree::nif::error(env, "The number of trees must be positive.");
+  }
+
+  if (!scitree::nif::get_atom(env, argv[2], quantize) ||
+      (quantize != "true" && quantize != "false"))
+  {
+    return scitree::nif::error(env, "Invalid quantize option.");
+  }
+
+  auto error = scitree::resource::require_trees(*p_model);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  std::unique_ptr<ygg::model::AbstractModel> model;
+  error = scitree::compact::compact_model(*p_model->model, max_trees, quantize == "true",
+                                          &model);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  scitree::resource::SCITREE_MODEL *p_compacted =
+      scitree::resource::alloc_model(RES_TYPE, std::move(model));
+  if (p_compacted == NULL)
+  {
+    return scitree::nif::error(env, "Unable to open resource.");
+  }
+
+  ERL_NIF_TERM resource = enif_make_resource(env, p_compacted);
+  enif_release_resource(p_compacted);
+
+  if (quantize == "true")
+  {
+    error = scitree::compact::flatten_resource(p_compacted);
+    if (error.status)
+    {
+      return scitree::nif::error(env, error.reason.c_str());
+    }
+  }
+
+  return enif_make_tuple2(env, scitree::nif::ok(env), resource);
+}
+
+static ERL_NIF_TERM save(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[]) {
+  scitree::resource::SCITREE_MODEL *p_model;
+
+  std::string path;
+
+  if (!scitree::nif::get(env, argv[1], path))
+  {
+    return scitree::nif::error(env, "Unable to get path.");
+  }
+
+  if (!enif_get_resource(env, argv[0], RES_TYPE, (void **)&p_model))
+  {
+    return scitree::nif::error(env, "Unable to load resource.");
+  }
+
+  auto error = scitree::resource::require_trees(*p_model);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  SaveModel(path, p_model->model.get());
+
+  return scitree::nif::ok(env);
+}
+
+static ERL_NIF_TERM load(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[]) {
+  std::string path;
+
+  if (!scitree::nif::get(env, argv[0], path)) {
+    return scitree::nif::error(env, "Unable to get path.");
+  }
+
+  std::unique_ptr<ygg::model::AbstractModel> model;
+
+  LoadModel(path, &model);
+
+  return make_model_resource(env, std::move(model));
+}
+
+static ERL_NIF_TERM serialize(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[]) {
+  scitree::resource::SCITREE_MODEL *p_model;
+
+  if (!enif_get_resource(env, argv[0], RES_TYPE, (void **)&p_model)) {
+    return scitree::nif::error(env, "Unable to load resource.");
+  }
+
+  auto error = scitree::resource::require_trees(*p_model);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  std::string serialized;
+  error = scitree::serialize::serialize_model(*p_model->model, &serialized);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  ERL_NIF_TERM binary;
+  unsigned char *data = enif_make_new_binary(env, serialized.size(), &binary);
+  std::memcpy(data, serialized.data(), serialized.size());
+
+  return enif_make_tuple2(env, scitree::nif::ok(env), binary);
+}
+
+static ERL_NIF_TERM deserialize(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[]) {
+  ErlNifBinary binary;
+
+  if (!enif_inspect_binary(env, argv[0], &binary)) {
+    return scitree::nif::error(env, "Unable to get binary.");
+  }
+
+  std::unique_ptr<ygg::model::AbstractModel> model;
+  auto error = scitree::serialize::deserialize_model(
+      reinterpret_cast<const char *>(binary.data), binary.size, &model);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  return make_model_resource(env, std::move(model));
+}
+
+static ERL_NIF_TERM memory_usage(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[]) {
+  scitree::resource::SCITREE_MODEL *p_model;
+
+  if (!enif_get_resource(env, argv[0], RES_TYPE, (void **)&p_model)) {
+    return scitree::nif::error(env, "Unable to load resource.");
+  }
+
+  ERL_NIF_TERM bytes = enif_make_uint64(env, p_model->size_in_bytes);
+
+  return enif_make_tuple2(env, scitree::nif::ok(env), bytes);
+}
+
+static ERL_NIF_TERM memory_stats(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[]) {
+  ERL_NIF_TERM keys[] = {enif_make_atom(env, "models"), enif_make_atom(env, "bytes")};
+  ERL_NIF_TERM values[] = {
+      enif_make_int64(env, scitree::resource::live_models.load()),
+      enif_make_int64(env, scitree::resource::live_bytes.load())};
+  ERL_NIF_TERM stats;
+
+  enif_make_map_from_arrays(env, keys, values, 2, &stats);
+
+  return enif_make_tuple2(env, scitree::nif::ok(env), stats);
+}
+
+// Time spent in each phase of the NIFs and row/byte counters since
+// the library was loaded.
+static ERL_NIF_TERM stats(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[]) {
+  return enif_make_tuple2(env, scitree::nif::ok(env), scitree::stats::make_stats(env));
+}
+
+static ERL_NIF_TERM show_dataspec(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[]) {
+  scitree::resource::SCITREE_MODEL *p_model;
+
+  if (!enif_get_resource(env, argv[0], RES_TYPE, (void **)&p_model)) {
+    return scitree::nif::error(env, "Unable to load resource.");
+  }
+
+  std::string data_spec = ygg::dataset::PrintHumanReadable(p_model->model->data_spec(), false);
+  ERL_NIF_TERM spec_str = enif_make_string(env, data_spec.c_str(), ERL_NIF_LATIN1);
+
+  return enif_make_tuple2(env, scitree::nif::ok(env), spec_str);
+}
+
+static ERL_NIF_TERM warmup(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[]) {
+  scitree::resource::SCITREE_MODEL *p_model;
+
+  if (!enif_get_resource(env, argv[0], RES_TYPE, (void **)&p_model)) {
+    return scitree::nif::error(env, "Unable to load resource.");
+  }
+
+  std::shared_ptr<const ygg::serving::FastEngine> serving_engine;
+  auto error_engine = scitree::resource::get_engine(p_model, &serving_engine);
+  if (error_engine.status)
+  {
+    return scitree::nif::error(env, error_engine.reason.c_str());
+  }
+
+  return scitree::nif::ok(env);
+}
+
+// Describes the serving engine of the model (compiled if needed),
+// whether it stores the model on 16 bits, the engines compatible
+// with it and the instruction sets of the library and of the CPU.
+static ERL_NIF_TERM engine_info(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[]) {
+  scitree::resource::SCITREE_MODEL *p_model;
+
+  if (!enif_get_resource(env, argv[0], RES_TYPE, (void **)&p_model)) {
+    return scitree::nif::error(env, "Unable to load resource.");
+  }
+
+  std::shared_ptr<const scitree::resource::SCITREE_ENGINE> serving;
+  auto error = scitree::resource::get_serving(p_model, &serving);
+  if (error.status)
+  {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  std::vector<ERL_NIF_TERM> compatible;
+  for (const auto &name : scitree::resource::compatible_engines(*p_model))
+    compatible.push_back(enif_make_string(env, name.c_str(), ERL_NIF_LATIN1));
+
+  std::vector<ERL_NIF_TERM> supported;
+  for (const auto &isa : scitree::cpu::supported_isas())
+    supported.push_back(enif_make_atom(env, isa.c_str()));
+
+  const bool quantized =
+      serving->name == scitree::flat::ENGINE_NAME &&
+      static_cast<const scitree::flat::SCITREE_FLAT_ENGINE &>(*serving->engine).quantized();
+
+  ERL_NIF_TERM keys[] = {
+      enif_make_atom(env, "engine"), enif_make_atom(env, "compatible_engines"),
+      enif_make_atom(env, "quantized"), enif_make_atom(env, "isa"),
+      enif_make_atom(env, "supported_isa")};
+  ERL_NIF_TERM values[] = {
+      enif_make_string(env, serving->name.c_str(), ERL_NIF_LATIN1),
+      enif_make_list_from_array(env, compatible.data(), compatible.size()),
+      enif_make_atom(env, quantized ? "true" : "false"),
+      enif_make_atom(env, scitree::cpu::compiled_isa()),
+      enif_make_list_from_array(env, supported.data(), supported.size())};
+  ERL_NIF_TERM info;
+
+  enif_make_map_from_arrays(env, keys, values, 5, &info);
+
+  return enif_make_tuple2(env, scitree::nif::ok(env), info);
+}
+
+// Rebuilds the engine of the model with argv[1] as forced engine
+// (empty for the best compatible one) and argv[2] as the list of
+// excluded engines.
+static ERL_NIF_TERM select_engine(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[]) {
+  scitree::resource::SCITREE_MODEL *p_model;
+  std::string name;
+  std::vector<ERL_NIF_TERM> terms;
+
+  if (!enif_get_resource(env, argv[0], RES_TYPE, (void **)&p_model)) {
+    return scitree::nif::error(env, "Unable to load resource.");
+  }
+
+  if (!scitree::nif::get(env, argv[1], name)) {
+    return scitree::nif::error(env, "Invalid engine name.");
+  }
+
+  if (!scitree::nif::get_list(env, argv[2], terms)) {
+    return scitree::nif::error(env, "Invalid excluded engines.");
+  }
+
+  std::vector<std::string> excluded(terms.size());
+  for (size_t i = 0; i < terms.size(); i++) {
+    if (!scitree::nif::get(env, terms[i], excluded[i])) {
+      return scitree::nif::error(env, "Invalid engine name.");
+    }
+  }
+
+  auto error = scitree::resource::select_engine(p_model, name, excluded);
+  if (error.status) {
+    return scitree::nif::error(env, error.reason.c_str());
+  }
+
+  return scitree::nif::ok(env);
 }
 
 static ErlNifFunc nif_funcs[] = {
-    {"train", 2, train},
+    {"train", 2, train, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"train_async", 3, train_async, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"train_from_path", 3, train_from_path, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"dataset_new", 1, dataset_new, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"tune", 6, tune, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"continue_training", 4, continue_training, ERL_NIF_DIRTY_JOB_CPU_BOUND},
     {"predict", 2, predict},
-    {"save", 2, save},
-    {"load", 1, load},
-    {"show_dataspec", 1, show_dataspec}};
+    {"predict_trees", 4, predict_trees},
+    {"predict_one", 2, predict_one},
+    {"bind", 2, bind_model, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"predict_bound", 2, predict_bound},
+    {"predict_from_path", 3, predict_from_path, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"predictor", 2, predictor, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"predict_chunk", 2, predict_chunk},
+    {"server_new", 3, server_new, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"server_submit", 3, server_submit},
+    {"evaluate", 3, evaluate, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"compact", 3, compact, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"save", 2, save, ERL_NIF_DIRTY_JOB_IO_BOUND},
+    {"load", 1, load, ERL_NIF_DIRTY_JOB_IO_BOUND},
+    {"serialize", 1, serialize, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"deserialize", 1, deserialize, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"memory_usage", 1, memory_usage},
+    {"memory_stats", 0, memory_stats},
+    {"stats", 0, stats},
+    {"show_dataspec", 1, show_dataspec},
+    {"warmup", 1, warmup, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"engine_info", 1, engine_info, ERL_NIF_DIRTY_JOB_CPU_BOUND},
+    {"select_engine", 3, select_engine, ERL_NIF_DIRTY_JOB_CPU_BOUND}};
 
-ERL_NIF_INIT(Elixir.Scitree.Native, nif_funcs, &load, &reload, NULL, NULL)
+ERL_NIF_INIT(Elixir.Scitree.Native, nif_funcs, &load, &reload, NULL, &unload)
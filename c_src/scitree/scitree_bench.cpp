@@ -0,0 +1,375 @@
+// Benchmarks of the native code paths behind the NIFs, on synthetic
+// datasets: ingestion (dataspec inference and VerticalDataset
+// construction), training per learner, and prediction latency and
+// throughput per batch size. Columns are generated already decoded,
+// so the numbers exclude the cost of reading Erlang terms; the
+// Elixir harness in bench/ measures the end-to-end cost.
+//
+// Every measurement is printed as one JSON object per line:
+//
+//   bazel run //scitree:scitree_bench -- --rows=1000,100000 --output=bench.jsonl
+
+#include "./scitree_concurrency.hpp"
+#include "./scitree_dataset.hpp"
+#include "./scitree_flat.hpp"
+#include "./scitree_learner.hpp"
+#include "./scitree_nif_helper.hpp"
+#include "./scitree_predict.hpp"
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/strings/str_split.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+ABSL_FLAG(std::string, rows, "1000,10000,100000", "Row counts of the synthetic datasets.");
+ABSL_FLAG(std::string, columns, "10,100", "Feature counts of the synthetic datasets.");
+ABSL_FLAG(std::string, mixes, "numerical,categorical,string,mixed", "Types of the feature columns.");
+ABSL_FLAG(std::string, learners, "cart,random_forest,gradient_boosted_trees", "Learners to train.");
+ABSL_FLAG(std::string, batch_sizes, "1,16,256,4096", "Batch sizes of the predictions.");
+ABSL_FLAG(std::string, engines, "yggdrasil,flat",
+          "Serving engines: the best one of yggdrasil or the flattened forest.");
+ABSL_FLAG(int, repetitions, 5, "Repetitions of the ingestion benchmarks.");
+ABSL_FLAG(int, predictions, 200, "Predictions measured per batch size.");
+ABSL_FLAG(int, threads, 0, "Ingestion and training threads (0: one per hardware thread).");
+ABSL_FLAG(std::string, output, "", "File of the results (stdout when empty).");
+
+namespace ygg = yggdrasil_decision_forests;
+namespace dataset = scitree::dataset;
+
+using clock_type = std::chrono::steady_clock;
+
+static scitree::concurrency::SCITREE_POOL POOL;
+
+static double seconds_since(clock_type::time_point start) {
+  return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+// Flat JSON object, written on a single line.
+class Record {
+ public:
+  Record(const std::string& benchmark) { add("benchmark", benchmark); }
+
+  Record& add(const std::string& key, const std::string& value) {
+    fields_ << (fields_.tellp() > 0 ? "," : "") << "\"" << key << "\":\"" << value << "\"";
+    return *this;
+  }
+
+  Record& add(const std::string& key, double value) {
+    fields_ << (fields_.tellp() > 0 ? "," : "") << "\"" << key << "\":" << value;
+    return *this;
+  }
+
+  std::string str() const { return "{" + fields_.str() + "}"; }
+
+ private:
+  std::ostringstream fields_;
+};
+
+// Synthetic dataset: `num_columns` features of the given mix and a
+// binary label that depends on the first features, so the learners
+// have something to fit.
+struct SYNTHETIC {
+  std::string mix;
+  int rows;
+  int columns;
+  std::vector<dataset::SCITREE_COLUMN> data;
+};
+
+static std::string column_type(const std::string& mix, int col) {
+  if (mix != "mixed")
+    return mix;
+
+  static const char* types[] = {"numerical", "categorical", "string"};
+  return types[col % 3];
+}
+
+static SYNTHETIC make_dataset(const std::string& mix, int rows, int columns) {
+  SYNTHETIC synthetic{mix, rows, columns, {}};
+  std::mt19937 rng(1234);
+  std::normal_distribution<float> normal;
+  std::uniform_int_distribution<int32_t> category(1, 32);
+  std::uniform_int_distribution<int> word(0, 999);
+  std::vector<float> score(rows, 0);
+  synthetic.data.reserve(columns + 1);
+
+  for (int col = 0; col < columns; col++) {
+    dataset::SCITREE_COLUMN column;
+    column.name = "f" + std::to_string(col);
+    column.type = column_type(mix, col);
+    column.length = rows;
+
+    for (int i = 0; i < rows; i++) {
+      float signal;
+
+      if (column.type == "numerical") {
+        column.numerical.push_back(normal(rng));
+        signal = column.numerical.back();
+      } else if (column.type == "categorical") {
+        column.categorical.push_back(category(rng));
+        signal = column.categorical.back() % 2 ? 1 : -1;
+      } else {
+        const int w = word(rng);
+        column.owned.push_back("w" + std::to_string(w));
+        signal = w % 2 ? 1 : -1;
+      }
+
+      if (col < 4)
+        score[i] += signal;
+    }
+
+    synthetic.data.push_back(std::move(column));
+  }
+
+  dataset::SCITREE_COLUMN label;
+  label.name = "label";
+  label.type = "categorical";
+  label.length = rows;
+  for (int i = 0; i < rows; i++)
+    label.categorical.push_back(score[i] + 0.5f * normal(rng) > 0 ? 2 : 1);
+  synthetic.data.push_back(std::move(label));
+
+  // The views are taken once the columns are in place, so they never
+  // point into the storage of a moved or copied column.
+  for (auto& column : synthetic.data) {
+    for (const auto& value : column.owned)
+      column.strings.push_back(value);
+  }
+
+  return synthetic;
+}
+
+static scitree::nif::SCITREE_ERROR ingest(std::vector<dataset::SCITREE_COLUMN> columns,
+                                          ygg::dataset::VerticalDataset* ds) {
+  ygg::dataset::proto::DataSpecification spec;
+  auto error = dataset::load_data_spec(&spec, columns);
+  if (error.status)
+    return error;
+
+  return dataset::load_dataset(ds, spec, &columns, true, &POOL);
+}
+
+static void bench_ingestion(const SYNTHETIC& synthetic, std::ostream& out) {
+  const int repetitions = absl::GetFlag(FLAGS_repetitions);
+  std::vector<double> times;
+
+  for (int r = 0; r < repetitions; r++) {
+    // Columns are consumed by the ingestion, copy them beforehand.
+    auto columns = synthetic.data;
+    ygg::dataset::VerticalDataset ds;
+
+    const auto start = clock_type::now();
+    auto error = ingest(std::move(columns), &ds);
+    times.push_back(seconds_since(start));
+
+    if (error.status) {
+      std::cerr << "ingestion: " << error.reason << std::endl;
+      return;
+    }
+  }
+
+  std::sort(times.begin(), times.end());
+  const double median = times[times.size() / 2];
+
+  out << Record("ingestion")
+             .add("mix", synthetic.mix)
+             .add("rows", synthetic.rows)
+             .add("columns", synthetic.columns)
+             .add("seconds", median)
+             .add("rows_per_second", synthetic.rows / median)
+             .str()
+      << std::endl;
+}
+
+static scitree::nif::SCITREE_CONFIG make_config(const std::string& learner) {
+  scitree::nif::SCITREE_CONFIG config;
+  config.label = "label";
+  config.learner = learner;
+  std::transform(config.learner.begin(), config.learner.end(), config.learner.begin(), ::toupper);
+  config.task = ygg::model::proto::Task::CLASSIFICATION;
+  config.options.maximum_training_duration_seconds = -1;
+  config.options.maximum_model_size_in_memory_in_bytes = -1;
+  config.options.random_seed = 123456;
+  config.num_threads = absl::GetFlag(FLAGS_threads);
+  return config;
+}
+
+static std::unique_ptr<ygg::model::AbstractModel> bench_training(
+    const SYNTHETIC& synthetic, const ygg::dataset::VerticalDataset& ds,
+    const std::string& learner, std::ostream& out) {
+  std::unique_ptr<ygg::model::AbstractModel> model;
+
+  const auto start = clock_type::now();
+  auto error = scitree::learner::train(make_config(learner), ds, &model);
+  const double seconds = seconds_since(start);
+
+  if (error.status) {
+    std::cerr << "training " << learner << ": " << error.reason << std::endl;
+    return nullptr;
+  }
+
+  out << Record("training")
+             .add("learner", learner)
+             .add("mix", synthetic.mix)
+             .add("rows", synthetic.rows)
+             .add("columns", synthetic.columns)
+             .add("seconds", seconds)
+             .str()
+      << std::endl;
+
+  return model;
+}
+
+// Scores windows of `batch_size` rows the way predict/2 does once
+// the terms are decoded: dataset of the batch, example set, engine.
+static void bench_prediction(const SYNTHETIC& synthetic, const ygg::model::AbstractModel& model,
+                             const std::string& learner, const std::string& engine_kind,
+                             int batch_size, std::ostream& out) {
+  std::unique_ptr<ygg::serving::FastEngine> fast_engine;
+
+  if (engine_kind == "flat") {
+    auto error = scitree::flat::build_engine(model, &fast_engine);
+    if (error.status) {
+      std::cerr << "engine " << learner << ": " << error.reason << std::endl;
+      return;
+    }
+  } else {
+    auto engine_or = model.BuildFastEngine();
+    if (!engine_or.ok()) {
+      std::cerr << "engine " << learner << ": " << engine_or.status().message() << std::endl;
+      return;
+    }
+    fast_engine = std::move(engine_or).value();
+  }
+  const auto& engine = *fast_engine;
+
+  batch_size = std::min(batch_size, synthetic.rows);
+  const int predictions = absl::GetFlag(FLAGS_predictions);
+  std::vector<double> latencies;
+  std::vector<float> output;
+
+  for (int p = 0; p < predictions; p++) {
+    const int begin = (p * batch_size) % (synthetic.rows - batch_size + 1);
+
+    std::vector<dataset::SCITREE_COLUMN> batch;
+    for (size_t col = 0; col + 1 < synthetic.data.size(); col++) {
+      const auto& source = synthetic.data[col];
+      dataset::SCITREE_COLUMN column;
+      column.name = source.name;
+      column.type = source.type;
+      column.length = batch_size;
+
+      if (source.type == "numerical")
+        column.numerical.assign(source.numerical.begin() + begin,
+                                source.numerical.begin() + begin + batch_size);
+      else if (source.type == "categorical")
+        column.categorical.assign(source.categorical.begin() + begin,
+                                  source.categorical.begin() + begin + batch_size);
+      else
+        column.strings.assign(source.strings.begin() + begin,
+                              source.strings.begin() + begin + batch_size);
+
+      batch.push_back(std::move(column));
+    }
+
+    const auto start = clock_type::now();
+
+    ygg::dataset::VerticalDataset ds;
+    auto error = dataset::load_dataset(&ds, model.data_spec(), &batch, false, &POOL);
+    if (!error.status)
+      error = scitree::predict::predict_dataset_sharded(&POOL, engine, ds, &output);
+
+    latencies.push_back(seconds_since(start));
+
+    if (error.status) {
+      std::cerr << "prediction: " << error.reason << std::endl;
+      return;
+    }
+  }
+
+  std::vector<double> sorted = latencies;
+  std::sort(sorted.begin(), sorted.end());
+  const auto percentile = [&sorted](double q) {
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(q * sorted.size()))];
+  };
+
+  double total = 0;
+  for (double latency : latencies)
+    total += latency;
+
+  out << Record("prediction")
+             .add("learner", learner)
+             .add("engine", engine_kind)
+             .add("mix", synthetic.mix)
+             .add("rows", synthetic.rows)
+             .add("columns", synthetic.columns)
+             .add("batch_size", batch_size)
+             .add("p50_us", percentile(0.5) * 1e6)
+             .add("p90_us", percentile(0.9) * 1e6)
+             .add("p99_us", percentile(0.99) * 1e6)
+             .add("rows_per_second", batch_size * latencies.size() / total)
+             .str()
+      << std::endl;
+}
+
+static std::vector<int> int_list(const std::string& flag) {
+  std::vector<int> values;
+  for (const auto& value : absl::StrSplit(flag, ',', absl::SkipEmpty()))
+    values.push_back(std::stoi(std::string(value)));
+  return values;
+}
+
+static std::vector<std::string> string_list(const std::string& flag) {
+  return absl::StrSplit(flag, ',', absl::SkipEmpty());
+}
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+  absl::SetFlag(&FLAGS_alsologtostderr, false);
+
+  scitree::concurrency::start_pool(&POOL, absl::GetFlag(FLAGS_threads));
+
+  std::ofstream file;
+  const std::string output = absl::GetFlag(FLAGS_output);
+  if (!output.empty())
+    file.open(output);
+  std::ostream& out = output.empty() ? std::cout : file;
+
+  for (const auto& mix : string_list(absl::GetFlag(FLAGS_mixes))) {
+    for (const int rows : int_list(absl::GetFlag(FLAGS_rows))) {
+      for (const int columns : int_list(absl::GetFlag(FLAGS_columns))) {
+        const SYNTHETIC synthetic = make_dataset(mix, rows, columns);
+        bench_ingestion(synthetic, out);
+
+        ygg::dataset::VerticalDataset ds;
+        auto error = ingest(synthetic.data, &ds);
+        if (error.status) {
+          std::cerr << "ingestion: " << error.reason << std::endl;
+          continue;
+        }
+
+        for (const auto& learner : string_list(absl::GetFlag(FLAGS_learners))) {
+          auto model = bench_training(synthetic, ds, learner, out);
+          if (model == nullptr)
+            continue;
+
+          for (const auto& engine : string_list(absl::GetFlag(FLAGS_engines))) {
+            for (const int batch_size : int_list(absl::GetFlag(FLAGS_batch_sizes)))
+              bench_prediction(synthetic, *model, learner, engine, batch_size, out);
+          }
+        }
+      }
+    }
+  }
+
+  scitree::concurrency::stop_pool(&POOL);
+
+  return 0;
+}
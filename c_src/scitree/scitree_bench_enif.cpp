@@ -0,0 +1,143 @@
+// Stubs of the erl_nif functions referenced by the headers linked in
+// the benchmark, which only works on decoded columns and never calls
+// them. Any call aborts. A function the headers start to reference
+// without a stub here fails the link of the benchmark.
+
+#include <cstdlib>
+#include <erl_nif.h>
+
+static void not_in_vm() { std::abort(); }
+
+int enif_get_atom(ErlNifEnv*, ERL_NIF_TERM, char*, unsigned, ErlNifCharEncoding) {
+  not_in_vm();
+  return 0;
+}
+
+int enif_get_atom_length(ErlNifEnv*, ERL_NIF_TERM, unsigned*, ErlNifCharEncoding) {
+  not_in_vm();
+  return 0;
+}
+
+int enif_get_double(ErlNifEnv*, ERL_NIF_TERM, double*) {
+  not_in_vm();
+  return 0;
+}
+
+int enif_get_int(ErlNifEnv*, ERL_NIF_TERM, int*) {
+  not_in_vm();
+  return 0;
+}
+
+int enif_get_long(ErlNifEnv*, ERL_NIF_TERM, long*) {
+  not_in_vm();
+  return 0;
+}
+
+// enif_get_int64 and enif_make_uint64 are macros over the long
+// variants on 64-bit platforms.
+#ifndef enif_get_int64
+int enif_get_int64(ErlNifEnv*, ERL_NIF_TERM, ErlNifSInt64*) {
+  not_in_vm();
+  return 0;
+}
+#endif
+
+#ifndef enif_make_uint64
+ERL_NIF_TERM enif_make_uint64(ErlNifEnv*, ErlNifUInt64) {
+  not_in_vm();
+  return 0;
+}
+#else
+ERL_NIF_TERM enif_make_ulong(ErlNifEnv*, unsigned long) {
+  not_in_vm();
+  return 0;
+}
+#endif
+
+int enif_get_list_cell(ErlNifEnv*, ERL_NIF_TERM, ERL_NIF_TERM*, ERL_NIF_TERM*) {
+  not_in_vm();
+  return 0;
+}
+
+int enif_get_list_length(ErlNifEnv*, ERL_NIF_TERM, unsigned*) {
+  not_in_vm();
+  return 0;
+}
+
+int enif_get_map_value(ErlNifEnv*, ERL_NIF_TERM, ERL_NIF_TERM, ERL_NIF_TERM*) {
+  not_in_vm();
+  return 0;
+}
+
+int enif_get_string(ErlNifEnv*, ERL_NIF_TERM, char*, unsigned, ErlNifCharEncoding) {
+  not_in_vm();
+  return 0;
+}
+
+int enif_get_tuple(ErlNifEnv*, ERL_NIF_TERM, int*, const ERL_NIF_TERM**) {
+  not_in_vm();
+  return 0;
+}
+
+int enif_inspect_binary(ErlNifEnv*, ERL_NIF_TERM, ErlNifBinary*) {
+  not_in_vm();
+  return 0;
+}
+
+int enif_is_atom(ErlNifEnv*, ERL_NIF_TERM) {
+  not_in_vm();
+  return 0;
+}
+
+int enif_is_binary(ErlNifEnv*, ERL_NIF_TERM) {
+  not_in_vm();
+  return 0;
+}
+
+ERL_NIF_TERM enif_make_atom(ErlNifEnv*, const char*) {
+  not_in_vm();
+  return 0;
+}
+
+ERL_NIF_TERM enif_make_string(ErlNifEnv*, const char*, ErlNifCharEncoding) {
+  not_in_vm();
+  return 0;
+}
+
+ERL_NIF_TERM enif_make_tuple(ErlNifEnv*, unsigned, ...) {
+  not_in_vm();
+  return 0;
+}
+
+unsigned char* enif_make_new_binary(ErlNifEnv*, size_t, ERL_NIF_TERM*) {
+  not_in_vm();
+  return nullptr;
+}
+
+ERL_NIF_TERM enif_make_new_map(ErlNifEnv*) {
+  not_in_vm();
+  return 0;
+}
+
+int enif_make_map_put(ErlNifEnv*, ERL_NIF_TERM, ERL_NIF_TERM, ERL_NIF_TERM, ERL_NIF_TERM*) {
+  not_in_vm();
+  return 0;
+}
+
+int enif_map_iterator_create(ErlNifEnv*, ERL_NIF_TERM, ErlNifMapIterator*,
+                             ErlNifMapIteratorEntry) {
+  not_in_vm();
+  return 0;
+}
+
+void enif_map_iterator_destroy(ErlNifEnv*, ErlNifMapIterator*) { not_in_vm(); }
+
+int enif_map_iterator_get_pair(ErlNifEnv*, ErlNifMapIterator*, ERL_NIF_TERM*, ERL_NIF_TERM*) {
+  not_in_vm();
+  return 0;
+}
+
+int enif_map_iterator_next(ErlNifEnv*, ErlNifMapIterator*) {
+  not_in_vm();
+  return 0;
+}
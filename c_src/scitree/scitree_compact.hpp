@@ -0,0 +1,155 @@
+#ifndef SCITREE_COMPACT
+#define SCITREE_COMPACT
+
+#include "./scitree_flat.hpp"
+#include "./scitree_nif_helper.hpp"
+#include "./scitree_resource.hpp"
+#include "./scitree_serialize.hpp"
+
+#include "yggdrasil_decision_forests/model/abstract_model.h"
+#include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
+#include "yggdrasil_decision_forests/model/gradient_boosted_trees/gradient_boosted_trees.h"
+#include "yggdrasil_decision_forests/model/random_forest/random_forest.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace scitree
+{
+namespace compact
+{
+
+namespace ygg = yggdrasil_decision_forests;
+namespace dt = yggdrasil_decision_forests::model::decision_tree;
+namespace gbt = yggdrasil_decision_forests::model::gradient_boosted_trees;
+namespace rf = yggdrasil_decision_forests::model::random_forest;
+
+// Rounds the thresholds and regression values of the nodes under
+// `node` to bfloat16 values. Class distributions are normalized and
+// their probabilities rounded the same way.
+void quantize_node(dt::NodeWithChildren* node) {
+  auto* proto_node = node->mutable_node();
+
+  if (proto_node->has_regressor())
+    proto_node->mutable_regressor()->set_top_value(
+        scitree::flat::round_bfloat16(proto_node->regressor().top_value()));
+
+  if (proto_node->has_classifier()) {
+    auto* distribution = proto_node->mutable_classifier()->mutable_distribution();
+    const double sum = distribution->sum();
+
+    if (sum > 0) {
+      for (int i = 0; i < distribution->counts_size(); i++)
+        distribution->set_counts(i, scitree::flat::round_bfloat16(distribution->counts(i) / sum));
+      distribution->set_sum(1);
+    }
+  }
+
+  if (node->IsLeaf())
+    return;
+
+  auto* condition = proto_node->mutable_condition()->mutable_condition();
+  if (condition->has_higher_condition()) {
+    auto* higher = condition->mutable_higher_condition();
+    higher->set_threshold(scitree::flat::round_bfloat16(higher->threshold()));
+  } else if (condition->has_oblique_condition()) {
+    auto* oblique = condition->mutable_oblique_condition();
+    oblique->set_threshold(scitree::flat::round_bfloat16(oblique->threshold()));
+  }
+
+  quantize_node(node->mutable_neg_child());
+  quantize_node(node->mutable_pos_child());
+}
+
+// Returns a copy of the model keeping its first `max_trees` trees
+// (whole iterations for multi-class boosted trees, all of them when
+// negative) and, when `quantize` is set, with its thresholds and
+// leaf values rounded to bfloat16, so the flattened forest stores
+// them on 16 bits. The model itself is left untouched.
+scitree::nif::SCITREE_ERROR compact_model(
+  const ygg::model::AbstractModel& model, int max_trees, bool quantize,
+  std::unique_ptr<ygg::model::AbstractModel>* compacted
+) {
+  scitree::nif::SCITREE_ERROR error;
+
+  if (max_trees == 0) {
+    error.status = true;
+    error.reason = "A compacted model keeps at least one tree.";
+    return error;
+  }
+
+  // The model is copied through its serialized form, its trees
+  // cannot be copied otherwise.
+  std::string serialized;
+  error = scitree::serialize::serialize_model(model, &serialized);
+  if (error.status)
+    return error;
+
+  error = scitree::serialize::deserialize_model(serialized.data(), serialized.size(), compacted);
+  if (error.status)
+    return error;
+
+  std::vector<std::unique_ptr<dt::DecisionTree>>* trees = nullptr;
+  int trees_per_iter = 1;
+
+  if (auto* forest = dynamic_cast<rf::RandomForestModel*>(compacted->get())) {
+    trees = forest->mutable_decision_trees();
+  } else if (auto* boosted = dynamic_cast<gbt::GradientBoostedTreesModel*>(compacted->get())) {
+    trees = boosted->mutable_decision_trees();
+    trees_per_iter = boosted->num_trees_per_iter();
+  } else {
+    error.status = true;
+    error.reason = "Only random forest and gradient boosted trees models can be compacted.";
+    return error;
+  }
+
+  if (max_trees > 0) {
+    const size_t kept = std::max(max_trees - max_trees % trees_per_iter, trees_per_iter);
+    if (kept < trees->size())
+      trees->resize(kept);
+  }
+
+  if (quantize) {
+    for (auto& tree : *trees)
+      quantize_node(tree->mutable_root());
+  }
+
+  return error;
+}
+
+// Serves the new resource of a quantized model from its flattened
+// forest alone: once the forest is compiled, the trees of the model
+// are dropped and the resource accounts for the rest of the model
+// and the forest. The trees are kept if any value of the forest
+// could not be stored on 16 bits.
+scitree::nif::SCITREE_ERROR flatten_resource(scitree::resource::SCITREE_MODEL* res) {
+  res->engine_name = scitree::flat::ENGINE_NAME;
+
+  std::shared_ptr<const scitree::resource::SCITREE_ENGINE> serving;
+  auto error = scitree::resource::get_serving(res, &serving);
+  if (error.status)
+    return error;
+
+  const auto& flat = static_cast<const scitree::flat::SCITREE_FLAT_ENGINE&>(*serving->engine);
+  if (!flat.quantized())
+    return error;
+
+  if (auto* forest = dynamic_cast<rf::RandomForestModel*>(res->model.get()))
+    forest->mutable_decision_trees()->clear();
+  else if (auto* boosted = dynamic_cast<gbt::GradientBoostedTreesModel*>(res->model.get()))
+    boosted->mutable_decision_trees()->clear();
+
+  scitree::resource::live_bytes -= res->size_in_bytes;
+  res->size_in_bytes = res->model->ModelSizeInBytes().value_or(0) + flat.SizeInBytes();
+  scitree::resource::live_bytes += res->size_in_bytes;
+  res->quantized = true;
+
+  return error;
+}
+
+}
+}
+
+#endif
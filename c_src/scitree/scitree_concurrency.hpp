@@ -0,0 +1,130 @@
+#ifndef SCITREE_CONCURRENCY
+#define SCITREE_CONCURRENCY
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace scitree
+{
+namespace concurrency
+{
+
+// Fixed set of native worker threads shared by the NIFs.
+struct SCITREE_POOL {
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<std::function<void()>> tasks;
+  std::vector<std::thread> workers;
+  bool stopping = false;
+};
+
+// Starts the workers. A non-positive number of threads uses
+// one worker per hardware thread.
+void start_pool(SCITREE_POOL* pool, int num_threads) {
+  if (num_threads <= 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+  pool->stopping = false;
+
+  for (int i = 0; i < num_threads; i++) {
+    pool->workers.emplace_back([pool]() {
+      while (true) {
+        std::function<void()> task;
+        {
+          std::unique_lock<std::mutex> lock(pool->mutex);
+          pool->cv.wait(lock, [pool]() { return pool->stopping || !pool->tasks.empty(); });
+
+          if (pool->tasks.empty())
+            return;
+
+          task = std::move(pool->tasks.front());
+          pool->tasks.pop_front();
+        }
+        task();
+      }
+    });
+  }
+}
+
+// Waits for queued tasks to finish and joins the workers.
+void stop_pool(SCITREE_POOL* pool) {
+  {
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    pool->stopping = true;
+  }
+  pool->cv.notify_all();
+
+  for (auto& worker : pool->workers)
+    worker.join();
+
+  pool->workers.clear();
+}
+
+void schedule(SCITREE_POOL* pool, std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    pool->tasks.push_back(std::move(task));
+  }
+  pool->cv.notify_one();
+}
+
+size_t num_workers(const SCITREE_POOL* pool) {
+  return pool == nullptr ? 0 : pool->workers.size();
+}
+
+// Calls fn(i) for every i in [0, n) and returns once all calls are
+// done. The calling thread takes part in the loop, so a busy (or
+// missing) pool degrades to a sequential loop instead of blocking.
+void parallel_for(SCITREE_POOL* pool, size_t n, const std::function<void(size_t)>& fn) {
+  if (n == 0)
+    return;
+
+  const size_t helpers = std::min(num_workers(pool), n - 1);
+
+  if (helpers == 0) {
+    for (size_t i = 0; i < n; i++)
+      fn(i);
+    return;
+  }
+
+  struct loop_state {
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> done{0};
+    std::mutex mutex;
+    std::condition_variable cv;
+  };
+  auto state = std::make_shared<loop_state>();
+
+  // Helpers only dereference fn while some index is left, i.e.
+  // while the caller is still waiting below.
+  auto run = [state, n, &fn]() {
+    size_t i;
+    while ((i = state->next++) < n) {
+      fn(i);
+      if (++state->done == n) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->cv.notify_all();
+      }
+    }
+  };
+
+  for (size_t i = 0; i < helpers; i++)
+    schedule(pool, run);
+
+  run();
+
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->cv.wait(lock, [&state, n]() { return state->done == n; });
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef SCITREE_CPU
+#define SCITREE_CPU
+
+#include <string>
+#include <vector>
+
+namespace scitree
+{
+namespace cpu
+{
+
+// Instruction set the library was compiled for. The library is
+// built once per variant (see the Makefile) and Scitree.Native
+// loads the most specialized one the CPU supports.
+inline const char* compiled_isa() {
+#if defined(__AVX512F__)
+  return "avx512";
+#elif defined(__AVX2__)
+  return "avx2";
+#else
+  return "generic";
+#endif
+}
+
+// Instruction sets of the variants supported by the current CPU,
+// from the least to the most specialized.
+std::vector<std::string> supported_isas() {
+  std::vector<std::string> isas = {"generic"};
+
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    isas.push_back("avx2");
+  if (__builtin_cpu_supports("avx512f"))
+    isas.push_back("avx512");
+#endif
+
+  return isas;
+}
+
+// Whether the CPU can run the instructions the library was compiled
+// with. Loading a variant on a CPU without them would end with an
+// illegal instruction on the first prediction.
+bool supports_compiled_isa() {
+  const std::string isa = compiled_isa();
+
+  for (const auto& supported : supported_isas()) {
+    if (supported == isa)
+      return true;
+  }
+
+  return false;
+}
+
+}
+}
+
+#endif
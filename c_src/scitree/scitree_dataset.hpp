@@ -1,14 +1,22 @@
 #ifndef SCITREE_DATASET
 #define SCITREE_DATASET
 
+#include "./scitree_concurrency.hpp"
+#include "./scitree_dictionary.hpp"
 #include "./scitree_nif_helper.hpp"
+#include "./scitree_stats.hpp"
 
 #include "yggdrasil_decision_forests/dataset/data_spec.h"
 #include "yggdrasil_decision_forests/dataset/data_spec_inference.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset_io.h"
 #include "yggdrasil_decision_forests/learner/learner_library.h"
 
+#include <deque>
 #include <map>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
+#include <limits>
 #include <cstring>
 #include <erl_nif.h>
 
@@ -29,22 +37,217 @@ static std::unordered_map<std::string, proto::ColumnType>
           {"string", proto::ColumnType::STRING},
       };
 
+// Below this number of values, columns are ingested on the
+// calling thread only.
+static const size_t PARALLEL_INGESTION_VALUES = 1 << 16;
+
+// Column of a dataset as received from Elixir. The values are
+// either a list of terms or a native-endian binary of packed
+// 32-bit values (f32 for numerical, s32 for categorical columns),
+// such as the output of `Nx.to_binary/1`.
+//
+// Lists are decoded once by decode_column into the typed buffer
+// matching the column type; the dataspec and the dataset are then
+// built from those buffers without touching the terms again.
+// String values are views over the memory of their binaries, which
+// stay alive as long as the terms; only charlists are copied, in
+// `owned`.
+struct SCITREE_COLUMN {
+  std::string name;
+  std::string type;
+  ERL_NIF_TERM values;
+  bool packed = false;
+  ErlNifBinary binary;
+  unsigned int length = 0;
+
+  std::vector<float> numerical;
+  std::vector<int32_t> categorical;
+  std::vector<std::string_view> strings;
+  std::deque<std::string> owned;
+};
+
+// Reads the values of a column whose name and type are known, as
+// a packed binary or as the length of its list.
+scitree::nif::SCITREE_ERROR get_values(ErlNifEnv *env, SCITREE_COLUMN* column) {
+  scitree::nif::SCITREE_ERROR error;
+
+  if (enif_is_binary(env, column->values)) {
+    enif_inspect_binary(env, column->values, &column->binary);
+
+    if (column->type == "string") {
+      error.status = true;
+      error.reason = "String column " + column->name + " must be a list.";
+      return error;
+    }
+
+    if (column->binary.size % sizeof(float) != 0) {
+      error.status = true;
+      error.reason = "Binary of column " + column->name + " is not a multiple of 32 bits.";
+      return error;
+    }
+
+    column->packed = true;
+    column->length = column->binary.size / sizeof(float);
+    return error;
+  }
+
+  if (!enif_get_list_length(env, column->values, &column->length)) {
+    error.status = true;
+    error.reason = "Unable get size of data.";
+  }
+
+  return error;
+}
+
+scitree::nif::SCITREE_ERROR get_column(
+  ErlNifEnv *env, ERL_NIF_TERM term, SCITREE_COLUMN* column
+) {
+  scitree::nif::SCITREE_ERROR error;
+  int size_dataset = 0;
+  const ERL_NIF_TERM* tuple_dataset;
+
+  if (!enif_get_tuple(env, term, &size_dataset, &tuple_dataset) || size_dataset != 3) {
+    error.status = true;
+    error.reason = "Invalid column, expected a {name, type, values} tuple.";
+    return error;
+  }
+
+  scitree::nif::get(env, tuple_dataset[0], column->name);
+  scitree::nif::get_atom(env, tuple_dataset[1], column->type);
+  column->values = tuple_dataset[2];
+
+  if (spec_types.find(column->type) == spec_types.end()) {
+    error.status = true;
+    error.reason = "type not identified to column " + column->name;
+    return error;
+  }
+
+  return get_values(env, column);
+}
+
+// Number of rows of a dataset, taken from its first column.
+unsigned int count_rows(ErlNifEnv *env, ERL_NIF_TERM list) {
+  ERL_NIF_TERM head, tail;
+  SCITREE_COLUMN column;
+
+  if (!enif_get_list_cell(env, list, &head, &tail))
+    return 0;
+
+  if (get_column(env, head, &column).status)
+    return 0;
+
+  return column.length;
+}
+
+// Reads the i-th value of a packed column. Binaries are not
+// guaranteed to be aligned, hence the memcpy.
+template <typename T>
+inline T packed_value(const SCITREE_COLUMN& column, unsigned int i) {
+  T value;
+  std::memcpy(&value, column.binary.data + i * sizeof(T), sizeof(T));
+  return value;
+}
+
+// Walks the list of a column once, storing the values in the
+// buffer of its type. Packed columns are read in place later on.
+scitree::nif::SCITREE_ERROR decode_column(ErlNifEnv *env, SCITREE_COLUMN* column) {
+  scitree::nif::SCITREE_ERROR error;
+
+  if (column->packed)
+    return error;
+
+  ERL_NIF_TERM head, tail;
+  ERL_NIF_TERM term = column->values;
+
+  if (column->type == "numerical") {
+    column->numerical.resize(column->length);
+  } else if (column->type == "categorical") {
+    column->categorical.resize(column->length);
+  } else if (column->type == "string") {
+    column->strings.resize(column->length);
+  } else {
+    return error;
+  }
+
+  for (unsigned int i = 0; i < column->length; ++i) {
+    if (!enif_get_list_cell(env, term, &head, &tail)) {
+      error.status = true;
+      error.reason = "Fail to get value to column " + column->name;
+      return error;
+    }
+
+    if (column->type == "numerical") {
+      // Values that are not floats are treated as missing.
+      float value = std::numeric_limits<float>::quiet_NaN();
+      scitree::nif::get(env, head, &value);
+      column->numerical[i] = value;
+    } else if (column->type == "categorical") {
+      int32_t value = ds::VerticalDataset::CategoricalColumn::kNaValue;
+      scitree::nif::get(env, head, &value);
+      column->categorical[i] = value;
+    } else {
+      ErlNifBinary bin;
+      if (enif_inspect_binary(env, head, &bin)) {
+        column->strings[i] = std::string_view(reinterpret_cast<const char *>(bin.data), bin.size);
+      } else {
+        column->owned.emplace_back();
+        scitree::nif::get(env, head, column->owned.back());
+        column->strings[i] = column->owned.back();
+      }
+    }
+
+    term = tail;
+  }
+
+  return error;
+}
+
+// Reads the columns of a dataset, decoding every value exactly once.
+scitree::nif::SCITREE_ERROR decode_columns(
+  ErlNifEnv *env, ERL_NIF_TERM* tuple, int column_size,
+  std::vector<SCITREE_COLUMN>* columns
+) {
+  scitree::nif::SCITREE_ERROR error;
+  scitree::stats::SCITREE_TIMER timer(scitree::stats::DECODE);
+  columns->resize(column_size);
+
+  for (int i = 0; i < column_size; i++) {
+    auto* column = &(*columns)[i];
+
+    error = get_column(env, tuple[i], column);
+    if (error.status)
+      return error;
+
+    if (column->length != (*columns)[0].length) {
+      error.status = true;
+      error.reason = "Column " + column->name + " has a different number of rows.";
+      return error;
+    }
+
+    error = decode_column(env, column);
+    if (error.status)
+      return error;
+
+    if (column->packed)
+      scitree::stats::add(scitree::stats::BYTES_DECODED, column->binary.size);
+  }
+
+  if (column_size > 0)
+    scitree::stats::add(scitree::stats::ROWS_DECODED, (*columns)[0].length);
+
+  return error;
+}
+
 scitree::nif::SCITREE_ERROR load_data_spec(
   proto::DataSpecification* data_spec,
-  ErlNifEnv *env, ERL_NIF_TERM* tuple, int size
+  const std::vector<SCITREE_COLUMN>& columns
 ) {
   scitree::nif::SCITREE_ERROR error;
   data_spec->clear_columns();
 
-  for (size_t i = 0; i < size; i++) {
-    std::string name, type;
-    int size_dataset = 0;
-    ERL_NIF_TERM* tuple_dataset;
-
-    enif_get_tuple(env, tuple[i], &size_dataset, &tuple_dataset);
-
-    scitree::nif::get(env, tuple_dataset[0], name);
-    scitree::nif::get_atom(env, tuple_dataset[1], type);
+  for (const auto& data_column : columns) {
+    const std::string& name = data_column.name;
+    const std::string& type = data_column.type;
 
     proto::Column* column;
     column = data_spec->add_columns();
@@ -75,200 +278,421 @@ scitree::nif::SCITREE_ERROR load_data_spec(
   return error;
 }
 
+// Updates the dataspec accumulator with the values of a column.
+void accumulate_column(
+  const SCITREE_COLUMN& column,
+  proto::Column* col,
+  proto::DataSpecificationAccumulator::Column* col_acc
+) {
+  const unsigned int length = column.length;
+
+  if (column.type == "numerical") {
+    for (unsigned int i = 0; i < length; ++i) {
+      const float value = column.packed ? packed_value<float>(column, i) : column.numerical[i];
+      ds::UpdateNumericalColumnSpec(value, col, col_acc);
+    }
+  } else if (column.type == "categorical") {
+    for (unsigned int i = 0; i < length; ++i) {
+      const int32_t value = column.packed ? packed_value<int32_t>(column, i) : column.categorical[i];
+      ds::UpdateCategoricalIntColumnSpec(value, col, col_acc);
+    }
+  } else if (column.type == "string") {
+    // Values are counted on views first, so the dictionary of the
+    // accumulator is only updated once per distinct value.
+    std::unordered_map<std::string_view, int64_t> counts;
+    int64_t count_nas = 0;
+
+    for (const auto& value : column.strings) {
+      if (value.empty())
+        count_nas++;
+      else
+        counts[value]++;
+    }
+
+    auto& items = *col_acc->mutable_items();
+    for (const auto& count : counts)
+      items[std::string(count.first)] += count.second;
+
+    col->set_count_nas(col->count_nas() + count_nas);
+  }
+}
+
+// Moves the values of a column into the dataset, encoding
+// categorical values against the column spec, or against its
+// dictionary when given.
+void fill_column(
+  SCITREE_COLUMN* column,
+  const proto::Column& col_spec,
+  ds::VerticalDataset* dataset, int col_idx,
+  const scitree::dictionary::SCITREE_DICTIONARY* dictionary = nullptr
+) {
+  const unsigned int length = column->length;
+
+  if (column->type == "numerical") {
+    auto* values = dataset->MutableColumnWithCast<ds::VerticalDataset::NumericalColumn>(col_idx)
+                       ->mutable_values();
+
+    if (column->packed) {
+      values->resize(length);
+      std::memcpy(values->data(), column->binary.data, length * sizeof(float));
+    } else {
+      *values = std::move(column->numerical);
+    }
+  } else if (column->type == "categorical") {
+    auto* values = dataset->MutableColumnWithCast<ds::VerticalDataset::CategoricalColumn>(col_idx)
+                       ->mutable_values();
+    const int32_t num_unique_values = col_spec.categorical().number_of_unique_values();
+
+    if (column->packed) {
+      values->resize(length);
+      std::memcpy(values->data(), column->binary.data, length * sizeof(int32_t));
+    } else {
+      *values = std::move(column->categorical);
+    }
+
+    for (auto& value : *values) {
+      if (value < ds::VerticalDataset::CategoricalColumn::kNaValue) {
+        // Treated as missing value.
+        value = ds::VerticalDataset::CategoricalColumn::kNaValue;
+      }
+      if (value >= num_unique_values) {
+        // Treated as out-of-dictionary.
+        value = 0;
+      }
+    }
+  } else if (column->type == "string") {
+    auto* values = dataset->MutableColumnWithCast<ds::VerticalDataset::CategoricalColumn>(col_idx)
+                       ->mutable_values();
+    values->resize(length);
+
+    for (unsigned int i = 0; i < length; ++i) {
+      const std::string_view value = column->strings[i];
+
+      if (value.empty()) {
+        (*values)[i] = ds::VerticalDataset::CategoricalColumn::kNaValue;
+      } else {
+        (*values)[i] = scitree::dictionary::encode(value, col_spec, dictionary);
+      }
+    }
+  }
+}
+
+// Builds a dataset from decoded columns. When infer_spec is set
+// (training), the column statistics and dictionaries are computed
+// from the data; otherwise (prediction) the given dataspec is used
+// as is. Columns that are not part of the dataspec are ignored.
+// String values are encoded with `dictionaries` (indexed like the
+// columns of the dataspec), built from the dataspec when not given.
+//
+// Columns are independent once decoded, so the accumulation and
+// the fill of large datasets are spread over the pool.
 scitree::nif::SCITREE_ERROR load_dataset(
   ds::VerticalDataset *dataset,
-  proto::DataSpecification* data_spec,
-  ErlNifEnv *env, ERL_NIF_TERM* tuple, int column_size
+  const proto::DataSpecification& data_spec,
+  std::vector<SCITREE_COLUMN>* columns,
+  bool infer_spec,
+  scitree::concurrency::SCITREE_POOL* pool = nullptr,
+  const std::vector<scitree::dictionary::SCITREE_DICTIONARY>* dictionaries = nullptr
 ) {
   scitree::nif::SCITREE_ERROR error;
-  dataset->set_data_spec(*data_spec);
+  dataset->set_data_spec(data_spec);
   dataset->CreateColumnsFromDataspec();
-  
-  // Initialize accumulator
-  ds::proto::DataSpecificationAccumulator accumulator;
-  ds::InitializeDataspecAccumulator(dataset->data_spec(), &accumulator);
-  
-  for (int i = 0; i < column_size; i++) {
-    std::string name, type;
-    int size_dataset = 0;
-    ERL_NIF_TERM* tuple_dataset;
 
-    enif_get_tuple(env, tuple[i], &size_dataset, &tuple_dataset);
-    scitree::nif::get(env, tuple_dataset[0], name);
-    scitree::nif::get_atom(env, tuple_dataset[1], type);
+  std::vector<int> col_idxs(columns->size());
+  for (size_t i = 0; i < columns->size(); i++) {
+    const auto& column = (*columns)[i];
+    col_idxs[i] = ds::GetColumnIdxFromName(column.name, dataset->data_spec());
 
-    ERL_NIF_TERM head, tail;
-    ERL_NIF_TERM term = tuple_dataset[2];
+    if (col_idxs[i] < 0)
+      continue;
 
-    auto col_type = spec_types.find(type);
-    if (col_type == spec_types.end()) {
+    const auto expected = column.type == "numerical" ? proto::ColumnType::NUMERICAL
+                                                     : proto::ColumnType::CATEGORICAL;
+    const auto actual = dataset->data_spec().columns(col_idxs[i]).type();
+    if (column.type != "unknown" && actual != expected) {
       error.status = true;
-      error.reason = "type not identified to column " + name;
+      error.reason = "Column " + column.name + " does not match the type of the dataspec.";
       return error;
     }
+  }
+
+  unsigned int rec_count = columns->empty() ? 0 : (*columns)[0].length;
+
+  if (static_cast<size_t>(rec_count) * columns->size() < PARALLEL_INGESTION_VALUES)
+    pool = nullptr;
+
+  if (infer_spec) {
+    scitree::stats::SCITREE_TIMER timer(scitree::stats::SPEC);
+    ds::proto::DataSpecificationAccumulator accumulator;
+    ds::InitializeDataspecAccumulator(dataset->data_spec(), &accumulator);
+
+    auto* spec = dataset->mutable_data_spec();
+    scitree::concurrency::parallel_for(pool, columns->size(), [&](size_t i) {
+      if (col_idxs[i] < 0)
+        return;
+
+      accumulate_column((*columns)[i],
+                        spec->mutable_columns(col_idxs[i]),
+                        accumulator.mutable_columns(col_idxs[i]));
+    });
+
+    ds::FinalizeComputeSpec({}, accumulator, dataset->mutable_data_spec());
+  }
+
+  scitree::stats::SCITREE_TIMER timer(scitree::stats::DATASET);
+
+  // Dictionaries of the spec computed above, when none is given.
+  std::vector<scitree::dictionary::SCITREE_DICTIONARY> spec_dictionaries;
+  if (dictionaries == nullptr) {
+    scitree::dictionary::build_dictionaries(dataset->data_spec(), &spec_dictionaries);
+    dictionaries = &spec_dictionaries;
+  }
+
+  // Add values in dataset
+  scitree::concurrency::parallel_for(pool, columns->size(), [&](size_t i) {
+    if (col_idxs[i] < 0)
+      return;
+
+    fill_column(&(*columns)[i], dataset->data_spec().columns(col_idxs[i]), dataset, col_idxs[i],
+                &(*dictionaries)[col_idxs[i]]);
+  });
+
+  // Columns of the dataspec missing from the data (e.g. the label
+  // when predicting) are filled with missing values.
+  for (int col_idx = 0; col_idx < dataset->ncol(); col_idx++) {
+    if (dataset->column(col_idx)->nrows() != rec_count)
+      dataset->mutable_column(col_idx)->Resize(rec_count);
+  }
+
+  dataset->mutable_data_spec()->set_created_num_rows(rec_count);
+  dataset->set_nrow(rec_count);
+
+  return error;
+}
+
+// Whether two column specs encode their values the same way, so the
+// values of one can be read with the other.
+bool same_encoding(const proto::Column& a, const proto::Column& b) {
+  if (a.name() != b.name() || a.type() != b.type())
+    return false;
+
+  if (a.type() != proto::ColumnType::CATEGORICAL)
+    return true;
+
+  const auto& cat_a = a.categorical();
+  const auto& cat_b = b.categorical();
 
-    unsigned int length = 0;
+  if (cat_a.is_already_integerized() != cat_b.is_already_integerized() ||
+      cat_a.number_of_unique_values() != cat_b.number_of_unique_values() ||
+      cat_a.items_size() != cat_b.items_size())
+    return false;
+
+  for (const auto& item : cat_a.items()) {
+    const auto it = cat_b.items().find(item.first);
+    if (it == cat_b.items().end() || it->second.index() != item.second.index())
+      return false;
+  }
+
+  return true;
+}
+
+// Whether a dataset can be read as is with the dataspec, i.e. it
+// has the same columns, in the same order and with the same
+// encoding (e.g. the dataset a model was trained on).
+bool same_encoding(const ds::VerticalDataset& dataset,
+                   const proto::DataSpecification& data_spec) {
+  if (dataset.data_spec().columns_size() != data_spec.columns_size())
+    return false;
+
+  for (int col_idx = 0; col_idx < data_spec.columns_size(); col_idx++) {
+    if (!same_encoding(dataset.data_spec().columns(col_idx), data_spec.columns(col_idx)))
+      return false;
+  }
 
-    if (!enif_get_list_length(env, term, &length)) 
-    {
+  return true;
+}
+
+// Re-encodes a dataset ingested with its own dataspec against
+// another dataspec (e.g. the one of a model) without decoding the
+// data again. Numerical values are copied and categorical indexes
+// are mapped through their representation, once per distinct value.
+// Columns of the dataspec missing from the source are filled with
+// missing values.
+scitree::nif::SCITREE_ERROR conform_dataset(
+  const ds::VerticalDataset& source,
+  const proto::DataSpecification& data_spec,
+  const std::vector<scitree::dictionary::SCITREE_DICTIONARY>& dictionaries,
+  ds::VerticalDataset* dataset,
+  scitree::concurrency::SCITREE_POOL* pool = nullptr
+) {
+  scitree::nif::SCITREE_ERROR error;
+  scitree::stats::SCITREE_TIMER timer(scitree::stats::DATASET);
+  const int64_t num_row = source.nrow();
+
+  dataset->set_data_spec(data_spec);
+  dataset->CreateColumnsFromDataspec();
+
+  std::vector<int> source_idxs(data_spec.columns_size());
+  for (int col_idx = 0; col_idx < data_spec.columns_size(); col_idx++) {
+    const auto& col_spec = data_spec.columns(col_idx);
+    source_idxs[col_idx] = ds::GetColumnIdxFromName(col_spec.name(), source.data_spec());
+
+    if (source_idxs[col_idx] >= 0 &&
+        source.data_spec().columns(source_idxs[col_idx]).type() != col_spec.type()) {
       error.status = true;
-      error.reason = "Unable get size of data.";
+      error.reason = "Column " + col_spec.name() + " does not match the type of the dataspec.";
       return error;
     }
+  }
 
-    int idx_type = col_type->second;
-    auto* col = dataset->mutable_data_spec()->mutable_columns(i);
-    auto* col_acc = accumulator.mutable_columns(i);
-
-    if (type == "numerical") {
-      for (unsigned int i = 0; i < length; ++i) {
-        if(!enif_get_list_cell(env, term, &head, &tail)) {
-          error.status = true;
-          error.reason = "Fail to get value to column " + name;
-          return error;
-        }
-
-        float value;
-        scitree::nif::get(env, head, &value);
-        ds::UpdateNumericalColumnSpec(value, col, col_acc);
-        term = tail;
-      }
-    } else if (type == "categorical") {
-      for (unsigned int i = 0; i < length; ++i) {
-        if(!enif_get_list_cell(env, term, &head, &tail)) {
-          error.status = true;
-          error.reason = "Fail to get value to column " + name;
-          return error;
-        }
-
-        int32_t value;
-        scitree::nif::get(env, head, &value);
-        ds::UpdateCategoricalIntColumnSpec(value, col, col_acc);
-        term = tail;
-      }
-    } else if (type == "string") {
-      for (unsigned int i = 0; i < length; ++i) {
-        if(!enif_get_list_cell(env, term, &head, &tail)) {
-          error.status = true;
-          error.reason = "Fail to get value to column " + name;
-          return error;
-        }
-
-        std::string value;
-        scitree::nif::get(env, head, value);
-        ds::UpdateCategoricalStringColumnSpec(value, col, col_acc);
-        term = tail;
-      }
+  if (static_cast<size_t>(num_row) * data_spec.columns_size() < PARALLEL_INGESTION_VALUES)
+    pool = nullptr;
+
+  scitree::concurrency::parallel_for(pool, data_spec.columns_size(), [&](size_t col_idx) {
+    const auto& col_spec = data_spec.columns(col_idx);
+    const int source_idx = source_idxs[col_idx];
+
+    if (source_idx < 0) {
+      dataset->mutable_column(col_idx)->Resize(num_row);
+      return;
+    }
+
+    if (col_spec.type() == proto::ColumnType::NUMERICAL) {
+      *dataset->MutableColumnWithCast<ds::VerticalDataset::NumericalColumn>(col_idx)
+           ->mutable_values() =
+          source.ColumnWithCast<ds::VerticalDataset::NumericalColumn>(source_idx)->values();
+      return;
+    }
+
+    const auto& source_spec = source.data_spec().columns(source_idx);
+    const auto& source_values =
+        source.ColumnWithCast<ds::VerticalDataset::CategoricalColumn>(source_idx)->values();
+    auto* values = dataset->MutableColumnWithCast<ds::VerticalDataset::CategoricalColumn>(col_idx)
+                       ->mutable_values();
+    const int32_t num_unique_values = col_spec.categorical().number_of_unique_values();
+
+    // Index in the dataspec of each index of the source.
+    std::vector<int32_t> mapping(source_spec.categorical().number_of_unique_values());
+    for (int32_t i = 0; i < static_cast<int32_t>(mapping.size()); i++) {
+      if (col_spec.categorical().is_already_integerized() &&
+          source_spec.categorical().is_already_integerized())
+        mapping[i] = i < num_unique_values ? i : 0;
+      else
+        mapping[i] = scitree::dictionary::encode(
+            ds::CategoricalIdxToRepresentation(source_spec, i), col_spec, &dictionaries[col_idx]);
     }
+
+    values->resize(num_row);
+    for (int64_t row = 0; row < num_row; row++) {
+      const int32_t value = source_values[row];
+      (*values)[row] = value < 0 ? ds::VerticalDataset::CategoricalColumn::kNaValue
+                                 : mapping[value];
+    }
+  });
+
+  dataset->mutable_data_spec()->set_created_num_rows(num_row);
+  dataset->set_nrow(num_row);
+
+  return error;
+}
+
+// Column types given as guide to the dataspec inference of files.
+static std::unordered_map<std::string, proto::ColumnType>
+      const guide_types = {
+          {"numerical", proto::ColumnType::NUMERICAL},
+          {"categorical", proto::ColumnType::CATEGORICAL},
+          {"string", proto::ColumnType::CATEGORICAL},
+      };
+
+// Column guides match names with regular expressions.
+std::string exact_pattern(const std::string& name) {
+  std::string pattern = "^";
+  for (char c : name) {
+    if (std::strchr("\\^$.|?*+()[]{}", c) != NULL)
+      pattern += '\\';
+    pattern += c;
   }
+  return pattern + "$";
+}
 
-  ds::FinalizeComputeSpec({}, accumulator, dataset->mutable_data_spec());
+void add_column_guide(proto::DataSpecificationGuide* guide,
+                      const std::string& name, proto::ColumnType type) {
+  auto* column_guide = guide->add_column_guides();
+  column_guide->set_column_name_pattern(exact_pattern(name));
+  column_guide->set_type(type);
+}
 
-  // Add values in dataset
-  unsigned int rec_count = 0;
-  for (int i = 0; i < column_size; i++) {
-    std::string name, type;
-    int size_dataset = 0;
-    ERL_NIF_TERM* tuple_dataset;
+// Reads a list of {name, type} tuples forcing the type of columns
+// of a dataset file. The other types are inferred by yggdrasil.
+scitree::nif::SCITREE_ERROR load_guide(
+  ErlNifEnv *env, ERL_NIF_TERM term, proto::DataSpecificationGuide* guide
+) {
+  scitree::nif::SCITREE_ERROR error;
+  std::vector<ERL_NIF_TERM> items;
+
+  if (!scitree::nif::get_list(env, term, items)) {
+    error.status = true;
+    error.reason = "Invalid column types.";
+    return error;
+  }
 
-    enif_get_tuple(env, tuple[i], &size_dataset, &tuple_dataset);
-    scitree::nif::get(env, tuple_dataset[0], name);
-    scitree::nif::get_atom(env, tuple_dataset[1], type);
+  for (ERL_NIF_TERM item : items) {
+    int size = 0;
+    const ERL_NIF_TERM* tuple;
+    std::string name, type;
 
-    ERL_NIF_TERM head, tail;
-    ERL_NIF_TERM term = tuple_dataset[2];
-    auto col_type = spec_types.find(type);
-    if (col_type == spec_types.end()) {
+    if (!enif_get_tuple(env, item, &size, &tuple) || size != 2 ||
+        !scitree::nif::get(env, tuple[0], name) ||
+        !scitree::nif::get_atom(env, tuple[1], type)) {
       error.status = true;
-      error.reason = "type not identified to column " + name;
+      error.reason = "Invalid column types.";
       return error;
     }
 
-    unsigned int length = 0;
-
-    if (!enif_get_list_length(env, term, &length)) 
-    {
+    auto guide_type = guide_types.find(type);
+    if (guide_type == guide_types.end()) {
       error.status = true;
-      error.reason = "Unable get size of data.";
+      error.reason = "type not identified to column " + name;
       return error;
     }
 
-    rec_count = length;
-
-    int idx_type = col_type->second;
-    const int col_idx = ds::GetColumnIdxFromName(name, dataset->data_spec());
-
-    if (type == "categorical") {
-      const auto& col_spec = dataset->data_spec().columns(i);
-      auto* col_data = dataset->MutableColumnWithCast<ds::VerticalDataset::CategoricalColumn>(col_idx);
-      col_data->Resize(0);
-
-      for (unsigned int i = 0; i < length; ++i) {
-        if(!enif_get_list_cell(env, term, &head, &tail)) {
-          error.status = true;
-          error.reason = "Fail to get value to column " + name;
-          return error;
-        }
-
-        int32_t value;
-        scitree::nif::get(env, head, &value);
-
-        if (value < ds::VerticalDataset::CategoricalColumn::kNaValue) {
-          // Treated as missing value.
-          value = ds::VerticalDataset::CategoricalColumn::kNaValue;
-        }
-        if (value >= col_spec.categorical().number_of_unique_values()) {
-          // Treated as out-of-dictionary.
-          value = 0;
-        }
-        col_data->Add(value);
-
-        term = tail;
-      }
-    } else if (type == "numerical") {
-      auto* col_num = dataset->MutableColumnWithCast<ds::VerticalDataset::NumericalColumn>(col_idx);
+    add_column_guide(guide, name, guide_type->second);
+  }
 
-      for (unsigned int i = 0; i < length; ++i) {
-        if(!enif_get_list_cell(env, term, &head, &tail)) {
-          error.status = true;
-          error.reason = "Fail to get value to column " + name;
-          return error;
-        }
+  return error;
+}
 
-        float value;
-        scitree::nif::get(env, head, &value);
+// Infers the dataspec of a dataset file, e.g. "csv:/data/train.csv".
+scitree::nif::SCITREE_ERROR infer_data_spec(
+  const std::string& typed_path,
+  const proto::DataSpecificationGuide& guide,
+  proto::DataSpecification* data_spec
+) {
+  scitree::nif::SCITREE_ERROR error;
 
-        col_num->Add(value);
-        term = tail;
-      }
-    } else if (type == "string") {
-      const auto& col_spec = dataset->data_spec().columns(i);
-      auto* col_data = dataset->MutableColumnWithCast<ds::VerticalDataset::CategoricalColumn>(col_idx);
-      col_data->Resize(0);
-
-      for (unsigned int i = 0; i < length; ++i) {
-        if(!enif_get_list_cell(env, term, &head, &tail)) {
-          error.status = true;
-          error.reason = "Fail to get value to column " + name;
-          return error;
-        }
-
-        std::string value;
-        scitree::nif::get(env, head, value);
-
-        if (value.empty()) {
-          col_data->AddNA();
-        } else {
-          col_data->Add(ds::CategoricalStringToValue(value, col_spec));
-        }
-
-        term = tail;
-      }
-    }
+  auto status = ds::CreateDataSpecWithStatus(typed_path, false, guide, data_spec);
+  if (!status.ok()) {
+    error.status = true;
+    error.reason = std::string(status.message());
   }
 
-  dataset->mutable_data_spec()->set_created_num_rows(rec_count);
-  dataset->set_nrow(rec_count);
+  return error;
+}
+
+// Loads the given columns of a dataset file with an existing dataspec.
+scitree::nif::SCITREE_ERROR load_dataset_from_path(
+  const std::string& typed_path,
+  const proto::DataSpecification& data_spec,
+  const std::vector<int>& required_columns,
+  ds::VerticalDataset* dataset
+) {
+  scitree::nif::SCITREE_ERROR error;
+
+  auto status = ds::LoadVerticalDataset(typed_path, data_spec, dataset, required_columns);
+  if (!status.ok()) {
+    error.status = true;
+    error.reason = std::string(status.message());
+  }
 
   return error;
 }
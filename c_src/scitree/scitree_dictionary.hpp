@@ -0,0 +1,102 @@
+#ifndef SCITREE_DICTIONARY
+#define SCITREE_DICTIONARY
+
+#include "yggdrasil_decision_forests/dataset/data_spec.h"
+#include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace scitree
+{
+namespace dictionary
+{
+
+namespace ds = yggdrasil_decision_forests::dataset;
+
+// Dictionary of a categorical string column, as an open addressing
+// table of views over the items of the dataspec. Lookups read the
+// value in place (e.g. from the memory of a binary) and never
+// allocate, unlike CategoricalStringToValue which takes a string.
+//
+// The views point into the dataspec of the model, which must
+// outlive the dictionary and not be modified.
+struct SCITREE_DICTIONARY {
+  std::vector<std::string_view> keys;
+  std::vector<int32_t> values;
+  size_t mask = 0;
+
+  bool empty() const { return keys.empty(); }
+
+  // Index of the value in the dictionary, or the out-of-dictionary
+  // index (0) for unknown values.
+  int32_t find(std::string_view value) const {
+    for (size_t slot = std::hash<std::string_view>()(value) & mask;; slot = (slot + 1) & mask) {
+      if (keys[slot].data() == nullptr)
+        return 0;
+      if (keys[slot] == value)
+        return values[slot];
+    }
+  }
+};
+
+// Builds the dictionary of a column. Columns that are not string
+// categorical columns get an empty dictionary.
+void build_dictionary(const ds::proto::Column& col_spec, SCITREE_DICTIONARY* dictionary) {
+  dictionary->keys.clear();
+  dictionary->values.clear();
+
+  if (col_spec.type() != ds::proto::ColumnType::CATEGORICAL ||
+      col_spec.categorical().is_already_integerized())
+    return;
+
+  const auto& items = col_spec.categorical().items();
+
+  // At most half full, so probes stay short.
+  size_t capacity = 2;
+  while (capacity < 2 * static_cast<size_t>(items.size()))
+    capacity <<= 1;
+
+  dictionary->keys.assign(capacity, std::string_view());
+  dictionary->values.assign(capacity, 0);
+  dictionary->mask = capacity - 1;
+
+  for (const auto& item : items) {
+    const std::string_view key(item.first);
+    size_t slot = std::hash<std::string_view>()(key) & dictionary->mask;
+
+    while (dictionary->keys[slot].data() != nullptr)
+      slot = (slot + 1) & dictionary->mask;
+
+    dictionary->keys[slot] = key;
+    dictionary->values[slot] = item.second.index();
+  }
+}
+
+// Builds the dictionaries of every column of the dataspec, indexed
+// like the columns.
+void build_dictionaries(const ds::proto::DataSpecification& data_spec,
+                        std::vector<SCITREE_DICTIONARY>* dictionaries) {
+  dictionaries->resize(data_spec.columns_size());
+
+  for (int col_idx = 0; col_idx < data_spec.columns_size(); col_idx++)
+    build_dictionary(data_spec.columns(col_idx), &(*dictionaries)[col_idx]);
+}
+
+// Encodes a string value against a column: with its dictionary when
+// it has one, with yggdrasil otherwise (e.g. integerized columns).
+inline int32_t encode(std::string_view value, const ds::proto::Column& col_spec,
+                      const SCITREE_DICTIONARY* dictionary) {
+  if (dictionary != nullptr && !dictionary->empty())
+    return dictionary->find(value);
+
+  return ds::CategoricalStringToValue(std::string(value), col_spec);
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef SCITREE_EVALUATION
+#define SCITREE_EVALUATION
+
+#include "./scitree_nif_helper.hpp"
+
+#include "yggdrasil_decision_forests/dataset/data_spec.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
+#include "yggdrasil_decision_forests/metric/metric.h"
+#include "yggdrasil_decision_forests/metric/metric.pb.h"
+#include "yggdrasil_decision_forests/model/abstract_model.h"
+#include "yggdrasil_decision_forests/utils/random.h"
+
+#include <cmath>
+#include <utility>
+#include <vector>
+#include <erl_nif.h>
+
+namespace scitree
+{
+namespace evaluation
+{
+
+namespace ygg = yggdrasil_decision_forests;
+namespace metric = yggdrasil_decision_forests::metric;
+
+using map_entries = std::vector<std::pair<const char*, ERL_NIF_TERM>>;
+
+ERL_NIF_TERM make_map(ErlNifEnv *env, const map_entries& entries) {
+  ERL_NIF_TERM map = enif_make_new_map(env);
+
+  for (const auto& entry : entries)
+    enif_make_map_put(env, map, enif_make_atom(env, entry.first), entry.second, &map);
+
+  return map;
+}
+
+ERL_NIF_TERM make_interval(ErlNifEnv *env, double lower, double upper) {
+  return enif_make_tuple2(env, enif_make_double(env, lower), enif_make_double(env, upper));
+}
+
+// 95% Wilson score interval of a proportion.
+std::pair<double, double> wilson_interval(double p, double n) {
+  if (n <= 0)
+    return {0, 0};
+
+  const double z = 1.959964;
+  const double center = (p + z * z / (2 * n)) / (1 + z * z / n);
+  const double margin = z * std::sqrt(p * (1 - p) / n + z * z / (4 * n * n)) / (1 + z * z / n);
+
+  return {center - margin, center + margin};
+}
+
+// Metrics of a classification evaluation, with the one-vs-rest
+// AUC and PR-AUC of each class keyed by class name.
+ERL_NIF_TERM make_classification(
+  ErlNifEnv *env, const metric::proto::EvaluationResults& eval,
+  const ygg::dataset::proto::Column& label, bool bootstrapped
+) {
+  const double accuracy = metric::Accuracy(eval);
+  const auto accuracy_ci = wilson_interval(accuracy, eval.count_predictions());
+
+  ERL_NIF_TERM classes = enif_make_new_map(env);
+  const auto& rocs = eval.classification().rocs();
+
+  // Index 0 is the out-of-dictionary item.
+  for (int class_idx = 1; class_idx < rocs.size(); class_idx++) {
+    const auto& roc = rocs.Get(class_idx);
+    map_entries entries = {
+        {"auc", enif_make_double(env, roc.auc())},
+        {"pr_auc", enif_make_double(env, roc.pr_auc())},
+    };
+
+    if (bootstrapped) {
+      entries.push_back({"auc_ci", make_interval(env, roc.bootstrap_lower_bounds_95p().auc(),
+                                                 roc.bootstrap_upper_bounds_95p().auc())});
+      entries.push_back({"pr_auc_ci", make_interval(env, roc.bootstrap_lower_bounds_95p().pr_auc(),
+                                                    roc.bootstrap_upper_bounds_95p().pr_auc())});
+    }
+
+    const std::string name = ygg::dataset::CategoricalIdxToRepresentation(label, class_idx);
+    ERL_NIF_TERM key;
+    unsigned char *data = enif_make_new_binary(env, name.size(), &key);
+    std::copy(name.begin(), name.end(), data);
+
+    enif_make_map_put(env, classes, key, make_map(env, entries), &classes);
+  }
+
+  return make_map(env, {
+      {"num_examples", enif_make_double(env, eval.count_predictions())},
+      {"accuracy", enif_make_double(env, accuracy)},
+      {"accuracy_ci", make_interval(env, accuracy_ci.first, accuracy_ci.second)},
+      {"log_loss", enif_make_double(env, metric::LogLoss(eval))},
+      {"classes", classes},
+  });
+}
+
+ERL_NIF_TERM make_regression(
+  ErlNifEnv *env, const metric::proto::EvaluationResults& eval, bool bootstrapped
+) {
+  map_entries entries = {
+      {"num_examples", enif_make_double(env, eval.count_predictions())},
+      {"rmse", enif_make_double(env, metric::RMSE(eval))},
+  };
+
+  if (bootstrapped) {
+    entries.push_back({"rmse_ci", make_interval(env, eval.regression().bootstrap_rmse_lower_bounds_95p(),
+                                                eval.regression().bootstrap_rmse_upper_bounds_95p())});
+  }
+
+  return make_map(env, entries);
+}
+
+// Evaluates the model on a dataset holding the label column and
+// returns the metrics as a map. Confidence intervals of AUC, PR-AUC
+// and RMSE are computed by bootstrapping when bootstrapping_samples
+// is positive.
+scitree::nif::SCITREE_ERROR evaluate(
+  ErlNifEnv *env,
+  const ygg::model::AbstractModel& model,
+  const ygg::dataset::VerticalDataset& dataset,
+  int bootstrapping_samples,
+  ERL_NIF_TERM* metrics
+) {
+  scitree::nif::SCITREE_ERROR error;
+
+  metric::proto::EvaluationOptions options;
+  options.set_task(model.task());
+  options.set_bootstrapping_samples(bootstrapping_samples);
+
+  ygg::utils::RandomEngine rnd(123456);
+  const auto eval = model.Evaluate(dataset, options, &rnd);
+  const bool bootstrapped = bootstrapping_samples > 0;
+
+  switch (model.task()) {
+    case ygg::model::proto::Task::CLASSIFICATION:
+      *metrics = make_classification(
+          env, eval, model.data_spec().columns(model.label_col_idx()), bootstrapped);
+      break;
+    case ygg::model::proto::Task::REGRESSION:
+      *metrics = make_regression(env, eval, bootstrapped);
+      break;
+    default:
+      error.status = true;
+      error.reason = "Evaluation is only supported for classification and regression.";
+  }
+
+  return error;
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,267 @@
+#ifndef SCITREE_EXAMPLES
+#define SCITREE_EXAMPLES
+
+#include "./scitree_dataset.hpp"
+#include "./scitree_dictionary.hpp"
+#include "./scitree_nif_helper.hpp"
+
+#include "yggdrasil_decision_forests/dataset/data_spec.h"
+#include "yggdrasil_decision_forests/model/abstract_model.h"
+#include "yggdrasil_decision_forests/serving/example_set.h"
+#include "yggdrasil_decision_forests/serving/fast_engine.h"
+
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <erl_nif.h>
+
+namespace scitree
+{
+namespace examples
+{
+
+namespace ygg = yggdrasil_decision_forests;
+namespace ds = yggdrasil_decision_forests::dataset;
+namespace serving = yggdrasil_decision_forests::serving;
+
+using features_definition = std::remove_cv_t<std::remove_reference_t<
+    decltype(std::declval<const serving::FastEngine&>().features())>>;
+
+// Input feature of a model, resolved once against the engine so
+// examples are written by index.
+struct SCITREE_FEATURE {
+  bool numerical;
+  features_definition::NumericalFeatureId numerical_id;
+  features_definition::CategoricalFeatureId categorical_id;
+  const ds::proto::Column* spec;
+  const scitree::dictionary::SCITREE_DICTIONARY* dictionary;
+};
+
+using feature_index = std::unordered_map<std::string, SCITREE_FEATURE>;
+
+// Maps the name of every input feature of the engine to its index
+// in the example set and to its dictionary (indexed like the
+// columns of the dataspec).
+void build_feature_index(const ygg::model::AbstractModel& model,
+                         const serving::FastEngine& engine,
+                         const std::vector<scitree::dictionary::SCITREE_DICTIONARY>& dictionaries,
+                         feature_index* index) {
+  const auto& features = engine.features();
+  index->clear();
+
+  for (const int col_idx : model.input_features()) {
+    const auto& col_spec = model.data_spec().columns(col_idx);
+
+    if (col_spec.type() == ds::proto::ColumnType::NUMERICAL) {
+      auto feature_id = features.GetNumericalFeatureId(col_spec.name());
+      if (feature_id.ok())
+        (*index)[col_spec.name()] = {true, feature_id.value(), {}, &col_spec, nullptr};
+    } else if (col_spec.type() == ds::proto::ColumnType::CATEGORICAL) {
+      auto feature_id = features.GetCategoricalFeatureId(col_spec.name());
+      if (feature_id.ok())
+        (*index)[col_spec.name()] = {false, {}, feature_id.value(), &col_spec,
+                                     &dictionaries[col_idx]};
+    }
+  }
+}
+
+// Checks that a decoded column can feed the feature.
+scitree::nif::SCITREE_ERROR check_column(const scitree::dataset::SCITREE_COLUMN& column,
+                                         const SCITREE_FEATURE& feature) {
+  scitree::nif::SCITREE_ERROR error;
+
+  if ((column.type == "numerical") != feature.numerical) {
+    error.status = true;
+    error.reason = "Column " + column.name + " does not match the type of the dataspec.";
+  }
+
+  return error;
+}
+
+// Writes the rows of a decoded column in the example set, from
+// example `offset` on.
+void write_column(const scitree::dataset::SCITREE_COLUMN& column,
+                  const SCITREE_FEATURE& feature, const features_definition& features,
+                  serving::AbstractExampleSet* examples, int offset) {
+  if (feature.numerical) {
+    for (unsigned int i = 0; i < column.length; i++) {
+      const float value = column.packed ? scitree::dataset::packed_value<float>(column, i)
+                                        : column.numerical[i];
+      if (std::isnan(value))
+        examples->SetMissingNumerical(offset + i, feature.numerical_id, features);
+      else
+        examples->SetNumerical(offset + i, feature.numerical_id, value, features);
+    }
+    return;
+  }
+
+  const int32_t num_unique_values = feature.spec->categorical().number_of_unique_values();
+
+  for (unsigned int i = 0; i < column.length; i++) {
+    int32_t value;
+
+    if (column.type == "string") {
+      value = column.strings[i].empty()
+                  ? ds::VerticalDataset::CategoricalColumn::kNaValue
+                  : scitree::dictionary::encode(column.strings[i], *feature.spec,
+                                                feature.dictionary);
+    } else {
+      value = column.packed ? scitree::dataset::packed_value<int32_t>(column, i)
+                            : column.categorical[i];
+      if (value >= num_unique_values)
+        // Treated as out-of-dictionary.
+        value = 0;
+    }
+
+    if (value < 0)
+      examples->SetMissingCategorical(offset + i, feature.categorical_id, features);
+    else
+      examples->SetCategorical(offset + i, feature.categorical_id, value, features);
+  }
+}
+
+// Sets `num_row` examples from `offset` on as missing for the feature.
+void write_missing(const SCITREE_FEATURE& feature, const features_definition& features,
+                   serving::AbstractExampleSet* examples, int offset, int num_row) {
+  for (int i = 0; i < num_row; i++) {
+    if (feature.numerical)
+      examples->SetMissingNumerical(offset + i, feature.numerical_id, features);
+    else
+      examples->SetMissingCategorical(offset + i, feature.categorical_id, features);
+  }
+}
+
+// Writes the rows of decoded columns directly into an example set,
+// from example `offset` on, without building a VerticalDataset.
+// Columns that are not input features of the engine are ignored and
+// input features without column are set as missing.
+scitree::nif::SCITREE_ERROR write_examples(
+  const feature_index& index,
+  const serving::FastEngine& engine,
+  const std::vector<scitree::dataset::SCITREE_COLUMN>& columns,
+  serving::AbstractExampleSet* examples, int offset
+) {
+  scitree::nif::SCITREE_ERROR error;
+  const auto& features = engine.features();
+  const int num_row = columns.empty() ? 0 : columns[0].length;
+  std::unordered_set<const SCITREE_FEATURE*> covered;
+
+  for (const auto& column : columns) {
+    const auto it = index.find(column.name);
+    if (it == index.end())
+      continue;
+
+    error = check_column(column, it->second);
+    if (error.status)
+      return error;
+
+    write_column(column, it->second, features, examples, offset);
+    covered.insert(&it->second);
+  }
+
+  for (const auto& entry : index) {
+    if (covered.count(&entry.second) == 0)
+      write_missing(entry.second, features, examples, offset, num_row);
+  }
+
+  return error;
+}
+
+// Writes a single example given as a map of feature name (binary or
+// atom) to value in the first row of the example set. Numbers are
+// numerical values or categorical indexes, binaries are categorical
+// strings and nil is a missing value. Unknown names are ignored and
+// features absent from the map are missing.
+scitree::nif::SCITREE_ERROR write_example(
+  ErlNifEnv* env, ERL_NIF_TERM map,
+  const feature_index& index,
+  const serving::FastEngine& engine,
+  serving::AbstractExampleSet* examples
+) {
+  scitree::nif::SCITREE_ERROR error;
+  const auto& features = engine.features();
+  ErlNifMapIterator iter;
+
+  if (!enif_map_iterator_create(env, map, &iter, ERL_NIF_MAP_ITERATOR_FIRST)) {
+    error.status = true;
+    error.reason = "The example must be a map.";
+    return error;
+  }
+
+  examples->FillMissing(features);
+
+  const ERL_NIF_TERM nil = enif_make_atom(env, "nil");
+  ERL_NIF_TERM key, value;
+  std::string name;
+  char atom[256];
+
+  for (; enif_map_iterator_get_pair(env, &iter, &key, &value);
+       enif_map_iterator_next(env, &iter)) {
+    ErlNifBinary bin;
+
+    if (enif_inspect_binary(env, key, &bin)) {
+      name.assign(reinterpret_cast<const char*>(bin.data), bin.size);
+    } else if (enif_get_atom(env, key, atom, sizeof(atom), ERL_NIF_LATIN1) > 0) {
+      name.assign(atom);
+    } else {
+      continue;
+    }
+
+    const auto it = index.find(name);
+    if (it == index.end())
+      continue;
+
+    const SCITREE_FEATURE& feature = it->second;
+    double number;
+    long integer;
+
+    if (enif_is_identical(value, nil))
+      // The feature stays missing.
+      continue;
+
+    if (feature.numerical) {
+      if (enif_get_double(env, value, &number)) {
+      } else if (enif_get_long(env, value, &integer)) {
+        number = integer;
+      } else {
+        error.status = true;
+        error.reason = "Feature " + name + " must be a number.";
+        break;
+      }
+
+      examples->SetNumerical(0, feature.numerical_id, static_cast<float>(number), features);
+    } else {
+      int32_t category;
+
+      if (enif_get_long(env, value, &integer)) {
+        category = integer >= feature.spec->categorical().number_of_unique_values() ? 0 : integer;
+      } else if (enif_inspect_binary(env, value, &bin)) {
+        category = scitree::dictionary::encode(
+            std::string_view(reinterpret_cast<const char*>(bin.data), bin.size), *feature.spec,
+            feature.dictionary);
+      } else {
+        error.status = true;
+        error.reason = "Feature " + name + " must be an integer or a string.";
+        break;
+      }
+
+      if (category >= 0)
+        examples->SetCategorical(0, feature.categorical_id, category, features);
+    }
+  }
+
+  enif_map_iterator_destroy(env, &iter);
+
+  return error;
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,660 @@
+#ifndef SCITREE_FLAT
+#define SCITREE_FLAT
+
+#include "./scitree_examples.hpp"
+#include "./scitree_nif_helper.hpp"
+
+#include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
+#include "yggdrasil_decision_forests/model/abstract_model.h"
+#include "yggdrasil_decision_forests/model/decision_tree/decision_tree.h"
+#include "yggdrasil_decision_forests/model/gradient_boosted_trees/gradient_boosted_trees.h"
+#include "yggdrasil_decision_forests/model/random_forest/random_forest.h"
+#include "yggdrasil_decision_forests/serving/example_set.h"
+#include "yggdrasil_decision_forests/serving/fast_engine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace scitree
+{
+namespace flat
+{
+
+namespace ygg = yggdrasil_decision_forests;
+namespace dt = yggdrasil_decision_forests::model::decision_tree;
+namespace gbt = yggdrasil_decision_forests::model::gradient_boosted_trees;
+namespace rf = yggdrasil_decision_forests::model::random_forest;
+namespace serving = yggdrasil_decision_forests::serving;
+
+// Name of the engine, as listed with the engines of yggdrasil.
+static const char* const ENGINE_NAME = "ScitreeFlatForest";
+
+// Rows traversed together, tree after tree, so the nodes of a tree
+// stay in cache for the whole block.
+static const int BLOCK_ROWS = 64;
+
+// Trees (iterations for multi-class boosted trees) added to all the
+// rows between two checks of the deadline of a prediction.
+static const int TREE_CHUNK = 8;
+
+// bfloat16, the upper half of a float, rounded to the nearest even.
+inline uint16_t to_bfloat16(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  bits += 0x7FFF + ((bits >> 16) & 1);
+  return bits >> 16;
+}
+
+inline float from_bfloat16(uint16_t value) {
+  const uint32_t bits = static_cast<uint32_t>(value) << 16;
+  float result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+inline float round_bfloat16(float value) { return from_bfloat16(to_bfloat16(value)); }
+
+// Forest compiled into flat arrays, one entry per node. The nodes of
+// each tree are laid out breadth-first, so the top of the tree is
+// contiguous and the two children of a node are adjacent: the
+// negative child is at `child` and the positive one right after.
+//
+// When every threshold and leaf value is a bfloat16 (e.g. the model
+// was compacted with quantization), they are stored on 16 bits in
+// `threshold16` and `leaf_values16` instead.
+struct SCITREE_FLAT_FOREST {
+  enum KIND : uint8_t { LEAF, HIGHER, CONTAINS, OBLIQUE, NA_NUMERICAL, NA_CATEGORICAL };
+  enum OUTPUT { AVERAGE, SUM, SIGMOID, SOFTMAX };
+
+  std::vector<uint8_t> kind;
+  std::vector<uint8_t> na_value;  // branch taken on a missing value
+  std::vector<int32_t> slot;      // attribute, as its slot in the examples
+  std::vector<float> threshold;
+  std::vector<int32_t> child;
+  std::vector<int32_t> payload;   // offset of the leaf values, bitmap or oblique split
+  std::vector<uint16_t> threshold16;
+
+  std::vector<uint32_t> bitmaps;
+  std::vector<int32_t> oblique_begin;  // one more entry than oblique splits
+  std::vector<int32_t> oblique_slots;
+  std::vector<float> oblique_weights;
+  std::vector<float> leaf_values;
+  std::vector<uint16_t> leaf_values16;
+  bool quantized = false;
+
+  std::vector<int32_t> roots;
+  std::vector<int32_t> tree_output;  // first accumulator a tree adds to
+
+  OUTPUT output = SUM;
+  int leaf_dims = 1;
+  int num_outputs = 1;
+  int trees_per_iter = 1;
+  std::vector<float> initial_predictions;
+};
+
+// Serving engine over a flattened forest, used for the models
+// yggdrasil has no fast engine for. Examples are stored
+// example-major by the example sets of yggdrasil, with missing values
+// imputed as for its own engines, and scored by blocks of rows.
+class SCITREE_FLAT_ENGINE : public serving::FastEngine {
+ public:
+  static constexpr serving::ExampleFormat kExampleSetFormat =
+      serving::ExampleFormat::FORMAT_EXAMPLE_MAJOR;
+  using ExampleSet = serving::ExampleSet<SCITREE_FLAT_ENGINE>;
+  using FLAT = SCITREE_FLAT_FOREST;
+
+  scitree::nif::SCITREE_ERROR compile(const ygg::model::AbstractModel& model);
+
+  std::unique_ptr<serving::AbstractExampleSet> AllocateExamples(int num_examples) const override {
+    return std::make_unique<ExampleSet>(num_examples, *this);
+  }
+
+  void Predict(const serving::AbstractExampleSet& examples, int num_examples,
+               std::vector<float>* predictions) const override {
+    PredictTrees(examples, num_examples, -1, std::chrono::steady_clock::time_point::max(),
+                 predictions);
+  }
+
+  // Scores the examples with the first `max_trees` trees (all when
+  // negative), adding no more trees once the deadline is passed.
+  // Returns the number of trees used.
+  int PredictTrees(const serving::AbstractExampleSet& examples, int num_examples,
+                   int max_trees, std::chrono::steady_clock::time_point deadline,
+                   std::vector<float>* predictions) const;
+
+  // Trees scored with at most `max_trees` trees (all when negative):
+  // whole iterations, at least one.
+  int NumTrees(int max_trees = -1) const {
+    const int num_trees = forest_.roots.size();
+    const int per_iter = forest_.trees_per_iter;
+    if (max_trees < 0)
+      return num_trees;
+    return std::min(num_trees, std::max(max_trees - max_trees % per_iter, per_iter));
+  }
+
+  int NumPredictionDimension() const override { return forest_.num_outputs; }
+
+  // Whether the thresholds and leaf values are stored on 16 bits.
+  bool quantized() const { return forest_.quantized; }
+
+  // Memory held by the flattened forest.
+  size_t SizeInBytes() const;
+
+  const scitree::examples::features_definition& features() const override { return features_; }
+
+ private:
+  using leaf_fn = std::function<void(const dt::proto::Node&, std::vector<float>*)>;
+
+  scitree::nif::SCITREE_ERROR add_tree(const ygg::dataset::proto::DataSpecification& data_spec,
+                                       const dt::DecisionTree& tree, int output,
+                                       const leaf_fn& leaf);
+
+  int32_t slot_of(const ygg::dataset::proto::Column& col_spec) const;
+
+  void quantize();
+
+  template <bool QUANTIZED>
+  void accumulate(const serving::NumericalOrCategoricalValue* values, size_t stride,
+                  int row_begin, int row_end, int tree_begin, int tree_end,
+                  float* accumulators) const;
+
+  SCITREE_FLAT_FOREST forest_;
+  scitree::examples::features_definition features_;
+};
+
+// Slot of an input feature in the examples, -1 if it is not one.
+int32_t SCITREE_FLAT_ENGINE::slot_of(const ygg::dataset::proto::Column& col_spec) const {
+  if (col_spec.type() == ygg::dataset::proto::ColumnType::NUMERICAL) {
+    auto feature_id = features_.GetNumericalFeatureId(col_spec.name());
+    return feature_id.ok() ? feature_id.value().index : -1;
+  }
+
+  auto feature_id = features_.GetCategoricalFeatureId(col_spec.name());
+  return feature_id.ok() ? feature_id.value().index : -1;
+}
+
+scitree::nif::SCITREE_ERROR SCITREE_FLAT_ENGINE::add_tree(
+  const ygg::dataset::proto::DataSpecification& data_spec,
+  const dt::DecisionTree& tree, int output, const leaf_fn& leaf
+) {
+  using ygg::dataset::proto::ColumnType;
+  scitree::nif::SCITREE_ERROR error;
+  auto& f = forest_;
+
+  f.roots.push_back(f.kind.size());
+  f.tree_output.push_back(output);
+
+  std::deque<const dt::NodeWithChildren*> queue = {&tree.root()};
+  int32_t next = f.roots.back() + 1;
+
+  for (; !queue.empty(); queue.pop_front()) {
+    const dt::NodeWithChildren* node = queue.front();
+    const auto& proto_node = node->node();
+
+    f.kind.push_back(FLAT::LEAF);
+    f.na_value.push_back(0);
+    f.slot.push_back(-1);
+    f.threshold.push_back(0);
+    f.child.push_back(-1);
+    f.payload.push_back(-1);
+
+    if (node->IsLeaf()) {
+      f.payload.back() = f.leaf_values.size();
+      leaf(proto_node, &f.leaf_values);
+      continue;
+    }
+
+    const auto& condition = proto_node.condition();
+    const auto& col_spec = data_spec.columns(condition.attribute());
+    const bool numerical = col_spec.type() == ColumnType::NUMERICAL;
+    const auto type = condition.condition().type_case();
+
+    f.child.back() = next;
+    f.na_value.back() = condition.na_value();
+    f.slot.back() = slot_of(col_spec);
+    next += 2;
+    queue.push_back(node->neg_child());
+    queue.push_back(node->pos_child());
+
+    if (type != dt::proto::Condition::kObliqueCondition &&
+        (f.slot.back() < 0 || (!numerical && col_spec.type() != ColumnType::CATEGORICAL))) {
+      error.status = true;
+      error.reason =
+          "Unable to flatten the model: unsupported attribute " + col_spec.name() + ".";
+      return error;
+    }
+
+    switch (type) {
+      case dt::proto::Condition::kHigherCondition:
+        f.kind.back() = FLAT::HIGHER;
+        f.threshold.back() = condition.condition().higher_condition().threshold();
+        break;
+
+      case dt::proto::Condition::kNaCondition:
+        f.kind.back() = numerical ? FLAT::NA_NUMERICAL : FLAT::NA_CATEGORICAL;
+        break;
+
+      case dt::proto::Condition::kContainsCondition:
+      case dt::proto::Condition::kContainsBitmapCondition: {
+        // The number of values of the column, then one bit per value.
+        const int32_t num_values = col_spec.categorical().number_of_unique_values();
+        f.kind.back() = FLAT::CONTAINS;
+        f.payload.back() = f.bitmaps.size();
+        f.bitmaps.push_back(num_values);
+        f.bitmaps.resize(f.bitmaps.size() + (num_values + 31) / 32, 0);
+        uint32_t* bitmap = f.bitmaps.data() + f.payload.back() + 1;
+
+        if (type == dt::proto::Condition::kContainsCondition) {
+          for (const int32_t value : condition.condition().contains_condition().elements()) {
+            if (value >= 0 && value < num_values)
+              bitmap[value / 32] |= 1u << (value % 32);
+          }
+        } else {
+          const std::string& bits =
+              condition.condition().contains_bitmap_condition().elements_bitmap();
+          const int32_t num_bits = std::min<int32_t>(num_values, bits.size() * 8);
+          for (int32_t value = 0; value < num_bits; value++) {
+            if ((bits[value / 8] >> (value % 8)) & 1)
+              bitmap[value / 32] |= 1u << (value % 32);
+          }
+        }
+        break;
+      }
+
+      case dt::proto::Condition::kObliqueCondition: {
+        const auto& oblique = condition.condition().oblique_condition();
+        f.kind.back() = FLAT::OBLIQUE;
+        f.threshold.back() = oblique.threshold();
+        f.payload.back() = f.oblique_begin.size() - 1;
+
+        for (int i = 0; i < oblique.attributes_size(); i++) {
+          const int32_t slot = slot_of(data_spec.columns(oblique.attributes(i)));
+          if (slot < 0) {
+            error.status = true;
+            error.reason = "Unable to flatten the model: unsupported oblique attribute.";
+            return error;
+          }
+
+          f.oblique_slots.push_back(slot);
+          f.oblique_weights.push_back(oblique.weights(i));
+        }
+        f.oblique_begin.push_back(f.oblique_slots.size());
+        break;
+      }
+
+      default:
+        error.status = true;
+        error.reason = "Unable to flatten the model: unsupported condition on " +
+                       col_spec.name() + ".";
+        return error;
+    }
+  }
+
+  return error;
+}
+
+// Compiles the trees of a random forest (or CART) or gradient boosted
+// trees model. The outputs are the ones of the engines of yggdrasil:
+// the probability of the positive class for binary classification,
+// of each class otherwise, and the value for regression and ranking.
+scitree::nif::SCITREE_ERROR SCITREE_FLAT_ENGINE::compile(const ygg::model::AbstractModel& model) {
+  scitree::nif::SCITREE_ERROR error;
+  const auto& data_spec = model.data_spec();
+  const bool classification = model.task() == ygg::model::proto::Task::CLASSIFICATION;
+  const int num_classes =
+      classification
+          ? data_spec.columns(model.label_col_idx()).categorical().number_of_unique_values() - 1
+          : 0;
+
+  forest_ = SCITREE_FLAT_FOREST();
+  forest_.oblique_begin.push_back(0);
+
+  auto status = features_.Initialize(model.input_features(), data_spec);
+  if (!status.ok()) {
+    error.status = true;
+    error.reason = "Unable to flatten the model: " + std::string(status.message());
+    return error;
+  }
+
+  if (const auto* forest = dynamic_cast<const rf::RandomForestModel*>(&model)) {
+    if (!classification && model.task() != ygg::model::proto::Task::REGRESSION) {
+      error.status = true;
+      error.reason = "Unable to flatten the model: unsupported task.";
+      return error;
+    }
+
+    // Classification leaves hold the vote or the distribution of the
+    // tree over the classes but the out-of-dictionary one, only for
+    // the positive class when there are two.
+    const bool binary = num_classes == 2;
+    const bool winner_take_all = forest->winner_take_all_inference();
+    forest_.output = FLAT::AVERAGE;
+    forest_.leaf_dims = classification ? (binary ? 1 : num_classes) : 1;
+    forest_.num_outputs = forest_.leaf_dims;
+
+    const leaf_fn leaf = [&](const dt::proto::Node& node, std::vector<float>* values) {
+      if (!classification) {
+        values->push_back(node.regressor().top_value());
+        return;
+      }
+
+      const auto& distribution = node.classifier().distribution();
+      for (int label = binary ? 2 : 1; label <= num_classes; label++) {
+        if (winner_take_all)
+          values->push_back(node.classifier().top_value() == label);
+        else
+          values->push_back(distribution.sum() > 0
+                                ? distribution.counts(label) / distribution.sum()
+                                : 0);
+      }
+    };
+
+    for (const auto& tree : forest->decision_trees()) {
+      error = add_tree(data_spec, *tree, 0, leaf);
+      if (error.status)
+        return error;
+    }
+  } else if (const auto* boosted = dynamic_cast<const gbt::GradientBoostedTreesModel*>(&model)) {
+    // Each tree of an iteration adds to its own accumulator, the
+    // logit of its class for multi-class classification.
+    const int trees_per_iter = boosted->num_trees_per_iter();
+    forest_.num_outputs = trees_per_iter;
+    forest_.trees_per_iter = trees_per_iter;
+    forest_.initial_predictions = boosted->initial_predictions();
+
+    if (boosted->loss() == gbt::proto::Loss::BINOMIAL_LOG_LIKELIHOOD)
+      forest_.output = FLAT::SIGMOID;
+    else if (boosted->loss() == gbt::proto::Loss::MULTINOMIAL_LOG_LIKELIHOOD)
+      forest_.output = FLAT::SOFTMAX;
+    else if (boosted->loss() == gbt::proto::Loss::SQUARED_ERROR ||
+             model.task() == ygg::model::proto::Task::RANKING)
+      forest_.output = FLAT::SUM;
+    else {
+      error.status = true;
+      error.reason = "Unable to flatten the model: unsupported loss.";
+      return error;
+    }
+
+    const leaf_fn leaf = [](const dt::proto::Node& node, std::vector<float>* values) {
+      values->push_back(node.regressor().top_value());
+    };
+
+    const auto& trees = boosted->decision_trees();
+    for (size_t i = 0; i < trees.size(); i++) {
+      error = add_tree(data_spec, *trees[i], i % trees_per_iter, leaf);
+      if (error.status)
+        return error;
+    }
+  } else {
+    error.status = true;
+    error.reason = "Unable to flatten the model: unsupported model type.";
+  }
+
+  if (!error.status)
+    quantize();
+
+  return error;
+}
+
+// Moves the thresholds and leaf values to their 16 bits arrays when
+// they all are bfloat16 values, halving their footprint.
+void SCITREE_FLAT_ENGINE::quantize() {
+  auto& f = forest_;
+  const auto exact = [](float value) { return round_bfloat16(value) == value; };
+
+  if (!std::all_of(f.threshold.begin(), f.threshold.end(), exact) ||
+      !std::all_of(f.leaf_values.begin(), f.leaf_values.end(), exact))
+    return;
+
+  f.threshold16.resize(f.threshold.size());
+  std::transform(f.threshold.begin(), f.threshold.end(), f.threshold16.begin(), to_bfloat16);
+  f.leaf_values16.resize(f.leaf_values.size());
+  std::transform(f.leaf_values.begin(), f.leaf_values.end(), f.leaf_values16.begin(),
+                 to_bfloat16);
+
+  std::vector<float>().swap(f.threshold);
+  std::vector<float>().swap(f.leaf_values);
+  f.quantized = true;
+}
+
+size_t SCITREE_FLAT_ENGINE::SizeInBytes() const {
+  const auto& f = forest_;
+  const auto bytes = [](const auto& values) { return values.capacity() * sizeof(values[0]); };
+
+  return sizeof(*this) + bytes(f.kind) + bytes(f.na_value) + bytes(f.slot) +
+         bytes(f.threshold) + bytes(f.child) + bytes(f.payload) + bytes(f.threshold16) +
+         bytes(f.bitmaps) + bytes(f.oblique_begin) + bytes(f.oblique_slots) +
+         bytes(f.oblique_weights) + bytes(f.leaf_values) + bytes(f.leaf_values16) +
+         bytes(f.roots) + bytes(f.tree_output) + bytes(f.initial_predictions);
+}
+
+// Adds the trees [tree_begin, tree_end) to the accumulators of the
+// rows [row_begin, row_end), by blocks of rows.
+template <bool QUANTIZED>
+void SCITREE_FLAT_ENGINE::accumulate(const serving::NumericalOrCategoricalValue* values,
+                                     size_t stride, int row_begin, int row_end,
+                                     int tree_begin, int tree_end, float* accumulators) const {
+  const auto& f = forest_;
+  const auto threshold = [&f](int32_t node) {
+    return QUANTIZED ? from_bfloat16(f.threshold16[node]) : f.threshold[node];
+  };
+  const auto leaf_value = [&f](int32_t offset) {
+    return QUANTIZED ? from_bfloat16(f.leaf_values16[offset]) : f.leaf_values[offset];
+  };
+
+  for (int begin = row_begin; begin < row_end; begin += BLOCK_ROWS) {
+    const int end = std::min(begin + BLOCK_ROWS, row_end);
+
+    for (int tree = tree_begin; tree < tree_end; tree++) {
+      for (int row = begin; row < end; row++) {
+        const auto* example = values + row * stride;
+        int32_t node = f.roots[tree];
+
+        while (f.kind[node] != FLAT::LEAF) {
+          bool positive;
+
+          switch (f.kind[node]) {
+            case FLAT::HIGHER: {
+              const float value = example[f.slot[node]].numerical_value;
+              positive = std::isnan(value) ? f.na_value[node] : value >= threshold(node);
+              break;
+            }
+            case FLAT::CONTAINS: {
+              const int32_t value = example[f.slot[node]].categorical_value;
+              const uint32_t* bitmap = f.bitmaps.data() + f.payload[node];
+              positive = value < 0 || value >= static_cast<int32_t>(bitmap[0])
+                             ? f.na_value[node]
+                             : (bitmap[1 + value / 32] >> (value % 32)) & 1;
+              break;
+            }
+            case FLAT::OBLIQUE: {
+              float sum = 0;
+              const int32_t split = f.payload[node];
+              for (int32_t i = f.oblique_begin[split]; i < f.oblique_begin[split + 1]; i++)
+                sum += f.oblique_weights[i] * example[f.oblique_slots[i]].numerical_value;
+              positive = std::isnan(sum) ? f.na_value[node] : sum >= threshold(node);
+              break;
+            }
+            case FLAT::NA_NUMERICAL:
+              positive = std::isnan(example[f.slot[node]].numerical_value);
+              break;
+            default:
+              positive = example[f.slot[node]].categorical_value < 0;
+          }
+
+          node = f.child[node] + positive;
+        }
+
+        float* accumulator =
+            accumulators + static_cast<size_t>(row) * f.num_outputs + f.tree_output[tree];
+        for (int d = 0; d < f.leaf_dims; d++)
+          accumulator[d] += leaf_value(f.payload[node] + d);
+      }
+    }
+  }
+}
+
+int SCITREE_FLAT_ENGINE::PredictTrees(const serving::AbstractExampleSet& examples,
+                                      int num_examples, int max_trees,
+                                      std::chrono::steady_clock::time_point deadline,
+                                      std::vector<float>* predictions) const {
+  const auto& f = forest_;
+  // Example-major: the features of an example are contiguous.
+  const auto& values =
+      static_cast<const ExampleSet&>(examples).InternalCategoricalAndNumericalValues();
+  const size_t stride = features_.fixed_length_features().size();
+  const int num_outputs = f.num_outputs;
+  std::vector<float> accumulators(static_cast<size_t>(num_examples) * num_outputs, 0.f);
+
+  const int num_trees = NumTrees(max_trees);
+
+  // The deadline is checked between chunks of trees, each added to
+  // all the rows so every row is scored by the same trees. Without
+  // deadline, each block of rows goes through all the trees at once.
+  const bool has_deadline = deadline != std::chrono::steady_clock::time_point::max();
+  const int chunk = has_deadline ? TREE_CHUNK * f.trees_per_iter : std::max(num_trees, 1);
+  int used = 0;
+
+  while (used < num_trees) {
+    const int chunk_end = std::min(used + chunk, num_trees);
+
+    if (f.quantized)
+      accumulate<true>(values.data(), stride, 0, num_examples, used, chunk_end,
+                       accumulators.data());
+    else
+      accumulate<false>(values.data(), stride, 0, num_examples, used, chunk_end,
+                        accumulators.data());
+
+    used = chunk_end;
+    if (has_deadline && std::chrono::steady_clock::now() >= deadline)
+      break;
+  }
+
+  predictions->resize(static_cast<size_t>(num_examples) * num_outputs);
+
+  for (int row = 0; row < num_examples; row++) {
+    const float* accumulator = accumulators.data() + static_cast<size_t>(row) * num_outputs;
+    float* prediction = predictions->data() + static_cast<size_t>(row) * num_outputs;
+
+    switch (f.output) {
+      case FLAT::AVERAGE:
+        for (int d = 0; d < num_outputs; d++)
+          prediction[d] = used > 0 ? accumulator[d] / used : 0;
+        break;
+      case FLAT::SUM:
+        prediction[0] = accumulator[0] + f.initial_predictions[0];
+        break;
+      case FLAT::SIGMOID:
+        prediction[0] = 1 / (1 + std::exp(-(accumulator[0] + f.initial_predictions[0])));
+        break;
+      case FLAT::SOFTMAX: {
+        float max = -INFINITY, sum = 0;
+        for (int d = 0; d < num_outputs; d++) {
+          prediction[d] = accumulator[d] + f.initial_predictions[d];
+          max = std::max(max, prediction[d]);
+        }
+        for (int d = 0; d < num_outputs; d++)
+          sum += prediction[d] = std::exp(prediction[d] - max);
+        for (int d = 0; d < num_outputs; d++)
+          prediction[d] /= sum;
+      }
+    }
+  }
+
+  return used;
+}
+
+// Builds the flattened engine of the model.
+scitree::nif::SCITREE_ERROR build_engine(const ygg::model::AbstractModel& model,
+                                         std::unique_ptr<serving::FastEngine>* engine) {
+  auto flat = std::make_unique<SCITREE_FLAT_ENGINE>();
+  auto error = flat->compile(model);
+
+  if (!error.status)
+    *engine = std::move(flat);
+
+  return error;
+}
+
+// Whether the node and the nodes under it only have conditions the
+// flattened forest supports, on input features of a supported type.
+static bool compatible_node(const dt::NodeWithChildren& node,
+                            const ygg::dataset::proto::DataSpecification& data_spec,
+                            const std::vector<int>& input_features) {
+  using ygg::dataset::proto::ColumnType;
+
+  if (node.IsLeaf())
+    return true;
+
+  const auto input = [&](int attribute, bool numerical_only) {
+    const auto type = data_spec.columns(attribute).type();
+    const bool feature = std::find(input_features.begin(), input_features.end(), attribute) !=
+                         input_features.end();
+    return feature && (type == ColumnType::NUMERICAL ||
+                       (!numerical_only && type == ColumnType::CATEGORICAL));
+  };
+
+  const auto& condition = node.node().condition();
+  switch (condition.condition().type_case()) {
+    case dt::proto::Condition::kHigherCondition:
+    case dt::proto::Condition::kNaCondition:
+    case dt::proto::Condition::kContainsCondition:
+    case dt::proto::Condition::kContainsBitmapCondition:
+      if (!input(condition.attribute(), false))
+        return false;
+      break;
+
+    case dt::proto::Condition::kObliqueCondition:
+      for (const int attribute : condition.condition().oblique_condition().attributes()) {
+        if (!input(attribute, true))
+          return false;
+      }
+      break;
+
+    default:
+      return false;
+  }
+
+  return compatible_node(*node.neg_child(), data_spec, input_features) &&
+         compatible_node(*node.pos_child(), data_spec, input_features);
+}
+
+// Whether the model can be flattened, from its type, task and loss
+// and the conditions of its nodes, without compiling it.
+bool compatible(const ygg::model::AbstractModel& model) {
+  const std::vector<std::unique_ptr<dt::DecisionTree>>* trees;
+
+  if (const auto* forest = dynamic_cast<const rf::RandomForestModel*>(&model)) {
+    if (model.task() != ygg::model::proto::Task::CLASSIFICATION &&
+        model.task() != ygg::model::proto::Task::REGRESSION)
+      return false;
+    trees = &forest->decision_trees();
+  } else if (const auto* boosted = dynamic_cast<const gbt::GradientBoostedTreesModel*>(&model)) {
+    const auto loss = boosted->loss();
+    if (loss != gbt::proto::Loss::BINOMIAL_LOG_LIKELIHOOD &&
+        loss != gbt::proto::Loss::MULTINOMIAL_LOG_LIKELIHOOD &&
+        loss != gbt::proto::Loss::SQUARED_ERROR &&
+        model.task() != ygg::model::proto::Task::RANKING)
+      return false;
+    trees = &boosted->decision_trees();
+  } else {
+    return false;
+  }
+
+  return std::all_of(trees->begin(), trees->end(), [&model](const auto& tree) {
+    return compatible_node(tree->root(), model.data_spec(), model.input_features());
+  });
+}
+
+}
+}
+
+#endif
@@ -2,9 +2,12 @@
 #define SCITREE_LEARNER
 
 #include "./scitree_nif_helper.hpp"
+#include "./scitree_stats.hpp"
 #include "yggdrasil_decision_forests/learner/learner_library.h"
 #include "yggdrasil_decision_forests/learner/decision_tree/generic_parameters.h"
 
+#include <algorithm>
+
 namespace ygg = yggdrasil_decision_forests;
 namespace model = yggdrasil_decision_forests::model;
 
@@ -30,8 +33,183 @@ model::proto::GenericHyperParameters get_hyper_params(nif::SCITREE_OPTIONS opts)
     random_seed->set_name(model::kHParamRandomSeed);
     random_seed->mutable_value()->set_integer(opts.random_seed);
 
+    for (const auto& hparam : opts.hyper_params) {
+        auto *field = hparams.add_fields();
+        field->set_name(hparam.name);
+
+        switch (hparam.type) {
+            case nif::SCITREE_HPARAM::INTEGER:
+                field->mutable_value()->set_integer(hparam.integer);
+                break;
+            case nif::SCITREE_HPARAM::REAL:
+                field->mutable_value()->set_real(hparam.real_value);
+                break;
+            case nif::SCITREE_HPARAM::CATEGORICAL:
+                field->mutable_value()->set_categorical(hparam.categorical);
+                break;
+        }
+    }
+
     return hparams;
 }
+
+// Sets a learner specific hyper-parameter, replacing the one of the
+// same name if any.
+void set_hyper_param(nif::SCITREE_OPTIONS* opts, const nif::SCITREE_HPARAM& hparam) {
+    auto& hyper_params = opts->hyper_params;
+
+    hyper_params.erase(std::remove_if(hyper_params.begin(), hyper_params.end(),
+                                      [&hparam](const nif::SCITREE_HPARAM& other) {
+                                          return other.name == hparam.name;
+                                      }),
+                       hyper_params.end());
+    hyper_params.push_back(hparam);
+}
+
+// Checks the learner specific hyper-parameters against the
+// specification of the learner. Integers given to real
+// hyper-parameters (e.g. `shrinkage: 1`) are converted.
+nif::SCITREE_ERROR validate_hyper_params(
+    const model::proto::GenericHyperParameterSpecification& spec,
+    const std::string& learner,
+    nif::SCITREE_OPTIONS* opts) {
+    nif::SCITREE_ERROR error;
+
+    for (auto& hparam : opts->hyper_params) {
+        auto field = spec.fields().find(hparam.name);
+        if (field == spec.fields().end()) {
+            error.status = true;
+            error.reason = "Unknown hyper-parameter " + hparam.name + " for learner " + learner + ".";
+            return error;
+        }
+
+        const auto& value = field->second;
+        bool valid = false;
+
+        if (value.has_integer()) {
+            valid = hparam.type == nif::SCITREE_HPARAM::INTEGER;
+        } else if (value.has_real()) {
+            if (hparam.type == nif::SCITREE_HPARAM::INTEGER) {
+                hparam.type = nif::SCITREE_HPARAM::REAL;
+                hparam.real_value = hparam.integer;
+            }
+            valid = hparam.type == nif::SCITREE_HPARAM::REAL;
+        } else if (value.has_categorical()) {
+            valid = hparam.type == nif::SCITREE_HPARAM::CATEGORICAL;
+        }
+
+        if (!valid) {
+            error.status = true;
+            error.reason = "Invalid type for hyper-parameter " + hparam.name + ".";
+            return error;
+        }
+    }
+
+    return error;
+}
+
+// Creates the learner described by the config, with its options.
+nif::SCITREE_ERROR make_learner(const nif::SCITREE_CONFIG& config,
+                                std::unique_ptr<model::AbstractLearner>* learner) {
+    nif::SCITREE_ERROR error;
+
+    // Training configuration
+    model::proto::TrainingConfig train_config;
+    train_config.set_learner(config.learner);
+    train_config.set_task(config.task);
+    train_config.set_label(config.label);
+
+    if (config.weights.length() > 0) {
+        auto* weights = train_config.mutable_weight_definition();
+        weights->set_attribute(config.weights);
+        weights->mutable_numerical();
+    }
+
+    // Config learner
+    auto status = model::GetLearner(train_config, learner);
+    if (!status.ok()) {
+        error.status = true;
+        error.reason = std::string(status.message());
+        return error;
+    }
+
+    if (config.log_directory.length() > 0)
+        (*learner)->set_log_directory(config.log_directory);
+
+    if (config.num_threads > 0)
+        (*learner)->mutable_deployment()->set_num_threads(config.num_threads);
+
+    // Define options
+    auto spec_or = (*learner)->GetGenericHyperParameterSpecification();
+    if (!spec_or.ok()) {
+        error.status = true;
+        error.reason = std::string(spec_or.status().message());
+        return error;
+    }
+
+    nif::SCITREE_OPTIONS options = config.options;
+    error = validate_hyper_params(spec_or.value(), config.learner, &options);
+    if (error.status)
+        return error;
+
+    status = (*learner)->SetHyperParameters(get_hyper_params(options));
+    if (!status.ok()) {
+        error.status = true;
+        error.reason = std::string(status.message());
+    }
+
+    return error;
+}
+
+// Trains a model on an already loaded dataset. It does not touch
+// any Erlang term, so it can run outside of a NIF call.
+nif::SCITREE_ERROR train(const nif::SCITREE_CONFIG& config,
+                         const ygg::dataset::VerticalDataset& dataset,
+                         std::unique_ptr<model::AbstractModel>* trained) {
+    std::unique_ptr<model::AbstractLearner> learner;
+    nif::SCITREE_ERROR error = make_learner(config, &learner);
+    if (error.status)
+        return error;
+
+    scitree::stats::SCITREE_TIMER timer(scitree::stats::TRAIN);
+    scitree::stats::add(scitree::stats::ROWS_TRAINED, dataset.nrow());
+
+    auto model_or = learner->TrainWithStatus(dataset);
+    if (!model_or.ok()) {
+        error.status = true;
+        error.reason = std::string(model_or.status().message());
+        return error;
+    }
+
+    *trained = std::move(model_or).value();
+
+    return error;
+}
+
+// Trains a model on a dataset file (e.g. "csv:/path/train.csv").
+// Yggdrasil reads the file itself, using a dataspec inferred from it.
+nif::SCITREE_ERROR train_from_path(const nif::SCITREE_CONFIG& config,
+                                   const std::string& typed_path,
+                                   const ygg::dataset::proto::DataSpecification& data_spec,
+                                   std::unique_ptr<model::AbstractModel>* trained) {
+    std::unique_ptr<model::AbstractLearner> learner;
+    nif::SCITREE_ERROR error = make_learner(config, &learner);
+    if (error.status)
+        return error;
+
+    scitree::stats::SCITREE_TIMER timer(scitree::stats::TRAIN);
+
+    auto model_or = learner->TrainWithStatus(typed_path, data_spec);
+    if (!model_or.ok()) {
+        error.status = true;
+        error.reason = std::string(model_or.status().message());
+        return error;
+    }
+
+    *trained = std::move(model_or).value();
+
+    return error;
+}
 }
 }
 
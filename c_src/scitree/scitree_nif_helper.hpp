@@ -5,6 +5,7 @@
 #include <string>
 #include <iostream>
 #include <algorithm>
+#include <vector>
 #include "yggdrasil_decision_forests/model/abstract_model.pb.h"
 
 namespace scitree
@@ -19,10 +20,22 @@ struct SCITREE_ERROR {
     std::string reason = "";
 };
 
+// Learner specific hyper-parameter, forwarded as is to yggdrasil.
+struct SCITREE_HPARAM {
+    enum Type { INTEGER, REAL, CATEGORICAL };
+
+    std::string name;
+    Type type;
+    int64_t integer = 0;
+    real real_value = 0;
+    std::string categorical;
+};
+
 struct SCITREE_OPTIONS {
     real maximum_training_duration_seconds;
     real maximum_model_size_in_memory_in_bytes;
     int random_seed;
+    std::vector<SCITREE_HPARAM> hyper_params;
 };
 
 struct SCITREE_CONFIG {
@@ -32,6 +45,10 @@ struct SCITREE_CONFIG {
     std::string log_directory;
     ygg::model::proto::Task task;
     SCITREE_OPTIONS options;
+    int num_threads = 0;
+    // Numerical column of the example weights. Only set natively,
+    // e.g. by the continued training of boosted trees.
+    std::string weights;
 };
 
 ERL_NIF_TERM ok(ErlNifEnv *env) {
@@ -145,11 +162,34 @@ int get_list(ErlNifEnv *env,
     return 1;
 }
 
+// Reads a hyper-parameter value: integers, floats, atoms (e.g.
+// booleans) and strings are accepted.
+int get_hparam(ErlNifEnv *env, ERL_NIF_TERM term, SCITREE_HPARAM *var) {
+    ErlNifSInt64 integer;
+    double real_value;
+    std::string categorical;
+
+    if (enif_get_int64(env, term, &integer)) {
+        var->type = SCITREE_HPARAM::INTEGER;
+        var->integer = integer;
+    } else if (enif_get_double(env, term, &real_value)) {
+        var->type = SCITREE_HPARAM::REAL;
+        var->real_value = real_value;
+    } else if (get_atom(env, term, categorical) || get(env, term, categorical)) {
+        var->type = SCITREE_HPARAM::CATEGORICAL;
+        var->categorical = categorical;
+    } else {
+        return 0;
+    }
+
+    return 1;
+}
+
 // scitree types
 SCITREE_CONFIG make_scitree_config(ErlNifEnv *env, ERL_NIF_TERM term) {
     SCITREE_CONFIG config;
 
-    ERL_NIF_TERM label_nif, learner_nif, log_directory_nif, task_nif, options_nif;
+    ERL_NIF_TERM label_nif, learner_nif, log_directory_nif, task_nif, options_nif, num_threads_nif;
     std::string label, learner, log_directory, task_str;
 
     enif_get_map_value(env, term, enif_make_atom(env, "label"), &label_nif);
@@ -158,6 +198,9 @@ SCITREE_CONFIG make_scitree_config(ErlNifEnv *env, ERL_NIF_TERM term) {
     enif_get_map_value(env, term, enif_make_atom(env, "task"), &task_nif);
     enif_get_map_value(env, term, enif_make_atom(env, "options"), &options_nif);
 
+    if (enif_get_map_value(env, term, enif_make_atom(env, "num_threads"), &num_threads_nif))
+        get(env, num_threads_nif, &config.num_threads);
+
     if (!get(env, label_nif, label)) {
         config.error.status = true;
         config.error.reason = "Unable to get label.";
@@ -232,16 +275,29 @@ SCITREE_CONFIG make_scitree_config(ErlNifEnv *env, ERL_NIF_TERM term) {
         {
             scitree::nif::get(env, (*(p_options.get()))[1], &config.options.maximum_training_duration_seconds);
         }
-
-        if (key == "maximum_model_size_in_memory_in_bytes")
+        else if (key == "maximum_model_size_in_memory_in_bytes")
         {
             scitree::nif::get(env, (*(p_options.get()))[1], &config.options.maximum_model_size_in_memory_in_bytes);
         }
-
-        if (key == "random_seed")
+        else if (key == "random_seed")
         {
             scitree::nif::get(env, (*(p_options.get()))[1], &config.options.random_seed);
         }
+        else
+        {
+            SCITREE_HPARAM hparam;
+            hparam.name = key;
+
+            if (!get_hparam(env, (*(p_options.get()))[1], &hparam))
+            {
+                config.error.status = true;
+                config.error.reason = "Invalid value for option " + key + ".";
+
+                return config;
+            }
+
+            config.options.hyper_params.push_back(hparam);
+        }
     }
 
     nif_dataset.clear();
@@ -0,0 +1,254 @@
+#ifndef SCITREE_PREDICT
+#define SCITREE_PREDICT
+
+#include "./scitree_concurrency.hpp"
+#include "./scitree_flat.hpp"
+#include "./scitree_nif_helper.hpp"
+#include "./scitree_stats.hpp"
+
+#include "yggdrasil_decision_forests/dataset/data_spec.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
+#include "yggdrasil_decision_forests/model/abstract_model.h"
+#include "yggdrasil_decision_forests/serving/example_set.h"
+#include "yggdrasil_decision_forests/serving/fast_engine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <erl_nif.h>
+
+namespace scitree
+{
+namespace predict
+{
+
+namespace ygg = yggdrasil_decision_forests;
+
+// Scores the rows [begin, end) of the dataset into `output`, which
+// receives NumPredictionDimension() values per row. Rows are copied
+// into the example set by windows of at most `capacity` rows.
+scitree::nif::SCITREE_ERROR predict_rows(
+  const ygg::serving::FastEngine& engine,
+  const ygg::dataset::VerticalDataset& dataset, int64_t begin, int64_t end,
+  ygg::serving::AbstractExampleSet* examples, int capacity, float* output
+) {
+  scitree::nif::SCITREE_ERROR error;
+  std::vector<float> window;
+
+  for (; begin < end; begin += capacity) {
+    const int64_t window_end = std::min(begin + capacity, end);
+
+    scitree::stats::SCITREE_TIMER copy_timer(scitree::stats::COPY_EXAMPLES);
+    auto status = ygg::serving::CopyVerticalDatasetToAbstractExampleSet(
+        dataset, begin, window_end, engine.features(), examples);
+    copy_timer.stop();
+    if (!status.ok()) {
+      error.status = true;
+      error.reason = std::string(status.message());
+      return error;
+    }
+
+    scitree::stats::SCITREE_TIMER predict_timer(scitree::stats::PREDICT);
+    engine.Predict(*examples, window_end - begin, &window);
+    predict_timer.stop();
+    scitree::stats::add(scitree::stats::ROWS_PREDICTED, window_end - begin);
+
+    output = std::copy(window.begin(), window.end(), output);
+  }
+
+  return error;
+}
+
+// Scores every row of the dataset. Rows are copied into the example
+// set by windows of at most `capacity` rows, so a fixed-size example
+// set can score a dataset of any size.
+scitree::nif::SCITREE_ERROR predict_dataset(
+  const ygg::serving::FastEngine& engine,
+  const ygg::dataset::VerticalDataset& dataset,
+  ygg::serving::AbstractExampleSet* examples, int capacity,
+  std::vector<float>* predictions
+) {
+  predictions->resize(dataset.nrow() * engine.NumPredictionDimension());
+
+  return predict_rows(engine, dataset, 0, dataset.nrow(), examples, capacity,
+                      predictions->data());
+}
+
+// Rows of a shard of a sharded prediction. Datasets up to one shard
+// are scored on the calling thread.
+static const int64_t SHARD_ROWS = 16384;
+
+// Scores every row of the dataset by shards of SHARD_ROWS rows spread
+// over the workers of the pool. Each shard uses its own example set
+// over the shared engine, which is safe to call concurrently, and
+// writes into a disjoint slice of the predictions.
+scitree::nif::SCITREE_ERROR predict_dataset_sharded(
+  scitree::concurrency::SCITREE_POOL* pool,
+  const ygg::serving::FastEngine& engine,
+  const ygg::dataset::VerticalDataset& dataset,
+  std::vector<float>* predictions
+) {
+  const int64_t num_row = dataset.nrow();
+  const int dims = engine.NumPredictionDimension();
+  const size_t num_shards = std::max<int64_t>(1, (num_row + SHARD_ROWS - 1) / SHARD_ROWS);
+  std::vector<scitree::nif::SCITREE_ERROR> errors(num_shards);
+
+  predictions->resize(num_row * dims);
+
+  scitree::concurrency::parallel_for(pool, num_shards, [&](size_t shard) {
+    const int64_t begin = shard * SHARD_ROWS;
+    const int64_t end = std::min(begin + SHARD_ROWS, num_row);
+    if (begin >= end)
+      return;
+
+    auto examples = engine.AllocateExamples(end - begin);
+    errors[shard] = predict_rows(engine, dataset, begin, end, examples.get(), end - begin,
+                                 predictions->data() + begin * dims);
+  });
+
+  for (const auto& error : errors) {
+    if (error.status)
+      return error;
+  }
+
+  return scitree::nif::SCITREE_ERROR();
+}
+
+// Scores every row of the dataset with the first `max_trees` trees
+// of the flattened forest (all when negative), adding no more trees
+// once the deadline is passed. All the rows are copied into one
+// example set so that they are scored by the same trees, whose
+// number is returned in `trees_used`.
+scitree::nif::SCITREE_ERROR predict_dataset_truncated(
+  const scitree::flat::SCITREE_FLAT_ENGINE& engine,
+  const ygg::dataset::VerticalDataset& dataset, int max_trees,
+  std::chrono::steady_clock::time_point deadline,
+  std::vector<float>* predictions, int* trees_used
+) {
+  scitree::nif::SCITREE_ERROR error;
+  const int64_t num_row = dataset.nrow();
+  auto examples = engine.AllocateExamples(std::max<int64_t>(1, num_row));
+
+  scitree::stats::SCITREE_TIMER copy_timer(scitree::stats::COPY_EXAMPLES);
+  auto status = ygg::serving::CopyVerticalDatasetToAbstractExampleSet(
+      dataset, 0, num_row, engine.features(), examples.get());
+  copy_timer.stop();
+  if (!status.ok()) {
+    error.status = true;
+    error.reason = std::string(status.message());
+    return error;
+  }
+
+  scitree::stats::SCITREE_TIMER predict_timer(scitree::stats::PREDICT);
+  *trees_used = engine.PredictTrees(*examples, num_row, max_trees, deadline, predictions);
+  predict_timer.stop();
+  scitree::stats::add(scitree::stats::ROWS_PREDICTED, num_row);
+
+  return error;
+}
+
+// Clamps probabilities to [0, 1] for classification.
+inline float postprocess(ygg::model::proto::Task task, float prediction) {
+  if (task == ygg::model::proto::Task::CLASSIFICATION)
+    return std::clamp(prediction, 0.f, 1.f);
+  return prediction;
+}
+
+// Returns the predictions as a single binary of native-endian f32
+// values, ready for Nx.from_binary/2.
+ERL_NIF_TERM make_predictions(
+  ErlNifEnv *env, ygg::model::proto::Task task,
+  const std::vector<float>& batch_of_predictions
+) {
+  scitree::stats::SCITREE_TIMER timer(scitree::stats::RESULT);
+  ERL_NIF_TERM binary;
+  const size_t batch_size = batch_of_predictions.size();
+  scitree::stats::add(scitree::stats::BYTES_RETURNED, batch_size * sizeof(float));
+  float *predictions = reinterpret_cast<float *>(
+      enif_make_new_binary(env, batch_size * sizeof(float), &binary));
+
+  if (task == ygg::model::proto::Task::CLASSIFICATION)
+  {
+    std::transform(batch_of_predictions.begin(), batch_of_predictions.end(), predictions,
+                   [task](float prediction) { return postprocess(task, prediction); });
+  }
+  else
+  {
+    std::memcpy(predictions, batch_of_predictions.data(), batch_size * sizeof(float));
+  }
+
+  return binary;
+}
+
+// Names of the prediction dimensions: the classes of the label for
+// classification (only the positive one for binary classification),
+// the label otherwise.
+std::vector<std::string> prediction_names(const ygg::model::AbstractModel& model, int dims) {
+  std::vector<std::string> names;
+  const auto& label = model.data_spec().columns(model.label_col_idx());
+
+  if (model.task() == ygg::model::proto::Task::CLASSIFICATION) {
+    const int first = dims == 1 ? 2 : 1;
+    for (int i = 0; i < dims; i++)
+      names.push_back(ygg::dataset::CategoricalIdxToRepresentation(label, first + i));
+  } else if (dims == 1) {
+    names.push_back(label.name());
+  } else {
+    for (int i = 0; i < dims; i++)
+      names.push_back(label.name() + "_" + std::to_string(i));
+  }
+
+  return names;
+}
+
+// Writes predictions to a csv file ("csv:/path" or "/path"), one row
+// per example and one column per prediction dimension.
+scitree::nif::SCITREE_ERROR write_predictions(
+  const std::string& typed_path,
+  const ygg::model::AbstractModel& model, int dims,
+  const std::vector<float>& predictions
+) {
+  scitree::nif::SCITREE_ERROR error;
+  std::string path = typed_path;
+
+  if (path.rfind("csv:", 0) == 0) {
+    path = path.substr(4);
+  } else if (path.find(':') != std::string::npos && path.find(':') < path.find('/')) {
+    error.status = true;
+    error.reason = "Predictions can only be written to csv files.";
+    return error;
+  }
+
+  std::ofstream file(path);
+  if (!file) {
+    error.status = true;
+    error.reason = "Unable to open " + path;
+    return error;
+  }
+
+  const auto names = prediction_names(model, dims);
+  for (int i = 0; i < dims; i++)
+    file << (i ? "," : "") << names[i];
+  file << "\n";
+
+  for (size_t row = 0; row * dims < predictions.size(); row++) {
+    for (int i = 0; i < dims; i++)
+      file << (i ? "," : "") << postprocess(model.task(), predictions[row * dims + i]);
+    file << "\n";
+  }
+
+  if (!file) {
+    error.status = true;
+    error.reason = "Unable to write " + path;
+  }
+
+  return error;
+}
+
+}
+}
+
+#endif
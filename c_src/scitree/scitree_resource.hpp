@@ -0,0 +1,506 @@
+#ifndef SCITREE_RESOURCE
+#define SCITREE_RESOURCE
+
+#include "./scitree_dictionary.hpp"
+#include "./scitree_examples.hpp"
+#include "./scitree_flat.hpp"
+#include "./scitree_nif_helper.hpp"
+#include "./scitree_stats.hpp"
+
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
+#include "yggdrasil_decision_forests/model/abstract_model.h"
+#include "yggdrasil_decision_forests/model/fast_engine_factory.h"
+#include "yggdrasil_decision_forests/serving/fast_engine.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <erl_nif.h>
+
+namespace scitree
+{
+namespace resource
+{
+
+namespace ygg = yggdrasil_decision_forests;
+
+// Serving engine of a model, with its name and the index of its
+// features. Predictors, bindings and servers share it with the
+// model, so they keep the engine they were built with when another
+// engine is selected for the model.
+//
+// `singles` holds the 1-row example sets of single predictions,
+// taken by each call and given back after it, so they are freed
+// with the engine and never shared by concurrent calls.
+struct SCITREE_ENGINE {
+  std::unique_ptr<ygg::serving::FastEngine> engine;
+  std::string name;
+  scitree::examples::feature_index features;
+
+  mutable std::mutex singles_mutex;
+  mutable std::vector<std::unique_ptr<ygg::serving::AbstractExampleSet>> singles;
+};
+
+// Takes a 1-row example set of the engine, allocating one when all
+// are in use.
+std::unique_ptr<ygg::serving::AbstractExampleSet> take_single(const SCITREE_ENGINE& serving) {
+  {
+    std::lock_guard<std::mutex> lock(serving.singles_mutex);
+    if (!serving.singles.empty()) {
+      auto examples = std::move(serving.singles.back());
+      serving.singles.pop_back();
+      return examples;
+    }
+  }
+
+  return serving.engine->AllocateExamples(1);
+}
+
+void give_single(const SCITREE_ENGINE& serving,
+                 std::unique_ptr<ygg::serving::AbstractExampleSet> examples) {
+  std::lock_guard<std::mutex> lock(serving.singles_mutex);
+  serving.singles.push_back(std::move(examples));
+}
+
+// Content of a model resource. The serving engine is compiled
+// lazily on the first prediction and shared by every process
+// holding the reference. It is the best engine compatible with the
+// model, unless `engine_name` forces one or `excluded_engines`
+// rules some out. The dictionaries of its string columns are built
+// once with the resource. `flat` caches the flattened forest of
+// truncated predictions when the serving engine is another one.
+// The trees of a `quantized` model are only held by its serving
+// engine, a flattened forest: `model` keeps everything else.
+struct SCITREE_MODEL {
+  std::unique_ptr<ygg::model::AbstractModel> model;
+  std::vector<scitree::dictionary::SCITREE_DICTIONARY> dictionaries;
+  std::mutex engine_mutex;
+  std::shared_ptr<const SCITREE_ENGINE> serving;
+  std::shared_ptr<const scitree::flat::SCITREE_FLAT_ENGINE> flat;
+  std::string engine_name;
+  std::vector<std::string> excluded_engines;
+  size_t size_in_bytes = 0;
+  bool quantized = false;
+};
+
+// Node-wide count of the models alive in resources and of their
+// size in memory, as reported by yggdrasil.
+static std::atomic<int64_t> live_models{0};
+static std::atomic<int64_t> live_bytes{0};
+
+// Fails for the calls that need the trees of the model once they
+// have been dropped by quantization.
+scitree::nif::SCITREE_ERROR require_trees(const SCITREE_MODEL& res) {
+  scitree::nif::SCITREE_ERROR error;
+
+  if (res.quantized) {
+    error.status = true;
+    error.reason = "The trees of a quantized model are only held by its flattened forest.";
+  }
+
+  return error;
+}
+
+// Allocates a resource of the given type that takes ownership of the model.
+SCITREE_MODEL* alloc_model(ErlNifResourceType* type,
+                           std::unique_ptr<ygg::model::AbstractModel> model) {
+  void* mem = enif_alloc_resource(type, sizeof(SCITREE_MODEL));
+  if (mem == NULL)
+    return NULL;
+
+  SCITREE_MODEL* res = new (mem) SCITREE_MODEL();
+  res->size_in_bytes = model->ModelSizeInBytes().value_or(0);
+  res->model = std::move(model);
+  scitree::dictionary::build_dictionaries(res->model->data_spec(), &res->dictionaries);
+
+  live_models++;
+  live_bytes += res->size_in_bytes;
+
+  return res;
+}
+
+// Destructor of the resource type, called once the last reference
+// to the model has been garbage collected.
+void free_model(ErlNifEnv* env, void* obj) {
+  SCITREE_MODEL* res = static_cast<SCITREE_MODEL*>(obj);
+
+  live_models--;
+  live_bytes -= res->size_in_bytes;
+
+  res->~SCITREE_MODEL();
+}
+
+// Dataset ingested once by Scitree.Dataset.new/2, with the dataspec
+// inferred from its values. It is never modified once built, so any
+// number of trainings, predictions and evaluations can read it
+// concurrently.
+struct SCITREE_DATASET {
+  ygg::dataset::VerticalDataset dataset;
+};
+
+SCITREE_DATASET* alloc_dataset(ErlNifResourceType* type) {
+  void* mem = enif_alloc_resource(type, sizeof(SCITREE_DATASET));
+  if (mem == NULL)
+    return NULL;
+
+  return new (mem) SCITREE_DATASET();
+}
+
+void free_dataset(ErlNifEnv* env, void* obj) {
+  static_cast<SCITREE_DATASET*>(obj)->~SCITREE_DATASET();
+}
+
+// Prediction state reused across the chunks of a stream. It holds a
+// reference on the model resource and an example set allocated once
+// for `capacity` rows.
+struct SCITREE_PREDICTOR {
+  SCITREE_MODEL* model;
+  std::shared_ptr<const ygg::serving::FastEngine> engine;
+  std::unique_ptr<ygg::serving::AbstractExampleSet> examples;
+  int capacity = 0;
+  std::mutex mutex;
+};
+
+SCITREE_PREDICTOR* alloc_predictor(ErlNifResourceType* type, SCITREE_MODEL* model,
+                                   std::shared_ptr<const ygg::serving::FastEngine> engine,
+                                   int capacity) {
+  void* mem = enif_alloc_resource(type, sizeof(SCITREE_PREDICTOR));
+  if (mem == NULL)
+    return NULL;
+
+  SCITREE_PREDICTOR* res = new (mem) SCITREE_PREDICTOR();
+  enif_keep_resource(model);
+  res->model = model;
+  res->examples = engine->AllocateExamples(capacity);
+  res->engine = std::move(engine);
+  res->capacity = capacity;
+
+  return res;
+}
+
+void free_predictor(ErlNifEnv* env, void* obj) {
+  SCITREE_PREDICTOR* res = static_cast<SCITREE_PREDICTOR*>(obj);
+
+  res->examples.reset();
+  res->engine.reset();
+  enif_release_resource(res->model);
+
+  res->~SCITREE_PREDICTOR();
+}
+
+// Columns of a dataset resolved once against the model, so datasets
+// can then be given as positional columns. Each column keeps its
+// name and type; `features` holds the input feature fed by each
+// column (null for the other columns of the dataspec) and `missing`
+// the input features without column.
+struct SCITREE_BINDING {
+  SCITREE_MODEL* model;
+  std::shared_ptr<const ygg::serving::FastEngine> engine;
+  std::vector<scitree::dataset::SCITREE_COLUMN> columns;
+  std::vector<const scitree::examples::SCITREE_FEATURE*> features;
+  std::vector<const scitree::examples::SCITREE_FEATURE*> missing;
+};
+
+// Resolves the column names against the dataspec and the features
+// of the engine. Names that are not in the dataspec are an error.
+scitree::nif::SCITREE_ERROR bind_columns(
+  const SCITREE_MODEL& model, const scitree::examples::feature_index& features,
+  const std::vector<std::string>& names, SCITREE_BINDING* binding
+) {
+  scitree::nif::SCITREE_ERROR error;
+  const auto& data_spec = model.model->data_spec();
+  std::vector<bool> bound(data_spec.columns_size(), false);
+
+  for (const auto& name : names) {
+    const int col_idx = ygg::dataset::GetColumnIdxFromName(name, data_spec);
+    if (col_idx < 0) {
+      error.status = true;
+      error.reason = "Column " + name + " is not in the dataspec of the model.";
+      return error;
+    }
+
+    if (bound[col_idx]) {
+      error.status = true;
+      error.reason = "Column " + name + " is bound twice.";
+      return error;
+    }
+    bound[col_idx] = true;
+
+    const auto& col_spec = data_spec.columns(col_idx);
+    scitree::dataset::SCITREE_COLUMN column;
+    column.name = name;
+
+    if (col_spec.type() == ygg::dataset::proto::ColumnType::NUMERICAL)
+      column.type = "numerical";
+    else if (col_spec.categorical().is_already_integerized())
+      column.type = "categorical";
+    else
+      column.type = "string";
+
+    const auto feature = features.find(name);
+    binding->features.push_back(feature == features.end() ? nullptr : &feature->second);
+    binding->columns.push_back(std::move(column));
+  }
+
+  for (const auto& entry : features) {
+    if (!bound[ygg::dataset::GetColumnIdxFromName(entry.first, data_spec)])
+      binding->missing.push_back(&entry.second);
+  }
+
+  return error;
+}
+
+SCITREE_BINDING* alloc_binding(ErlNifResourceType* type, SCITREE_MODEL* model,
+                               std::shared_ptr<const ygg::serving::FastEngine> engine) {
+  void* mem = enif_alloc_resource(type, sizeof(SCITREE_BINDING));
+  if (mem == NULL)
+    return NULL;
+
+  SCITREE_BINDING* res = new (mem) SCITREE_BINDING();
+  enif_keep_resource(model);
+  res->model = model;
+  res->engine = std::move(engine);
+
+  return res;
+}
+
+void free_binding(ErlNifEnv* env, void* obj) {
+  SCITREE_BINDING* res = static_cast<SCITREE_BINDING*>(obj);
+
+  res->engine.reset();
+  enif_release_resource(res->model);
+
+  res->~SCITREE_BINDING();
+}
+
+// Names of the serving engines compatible with the model, the
+// flattened forest of scitree last (and alone once quantized).
+std::vector<std::string> compatible_engines(const SCITREE_MODEL& res) {
+  const auto& model = *res.model;
+  std::vector<std::string> names;
+
+  if (res.quantized)
+    return {scitree::flat::ENGINE_NAME};
+
+  for (const auto& factory : model.ListCompatibleFastEngines())
+    names.push_back(factory->name());
+
+  if (scitree::flat::compatible(model))
+    names.push_back(scitree::flat::ENGINE_NAME);
+
+  return names;
+}
+
+// Builds the engine of the model. Among the compatible engines
+// allowed by the selection of the model, the engines another one
+// is better than are dropped, as BuildFastEngine does, and the
+// first remaining one is built. The flattened forest of scitree is
+// built when no engine of yggdrasil is allowed or builds, unless it
+// is excluded.
+scitree::nif::SCITREE_ERROR build_engine(
+  const SCITREE_MODEL& res,
+  std::shared_ptr<const SCITREE_ENGINE>* serving
+) {
+  scitree::nif::SCITREE_ERROR error;
+  const auto factories = res.model->ListCompatibleFastEngines();
+  std::vector<const ygg::model::FastEngineFactory*> candidates;
+
+  for (const auto& factory : factories) {
+    const std::string name = factory->name();
+
+    if (!res.engine_name.empty() && name != res.engine_name)
+      continue;
+    if (std::find(res.excluded_engines.begin(), res.excluded_engines.end(), name) !=
+        res.excluded_engines.end())
+      continue;
+
+    candidates.push_back(factory.get());
+  }
+
+  const std::string flat_name = scitree::flat::ENGINE_NAME;
+  const bool flat_allowed =
+      (res.engine_name.empty() || res.engine_name == flat_name) &&
+      std::find(res.excluded_engines.begin(), res.excluded_engines.end(), flat_name) ==
+          res.excluded_engines.end();
+
+  const ygg::model::FastEngineFactory* best = nullptr;
+  for (const auto* candidate : candidates) {
+    bool superseded = false;
+
+    for (const auto* other : candidates) {
+      const auto worse = other->IsBetterThan();
+      superseded |= std::find(worse.begin(), worse.end(), candidate->name()) != worse.end();
+    }
+
+    if (!superseded) {
+      best = candidate;
+      break;
+    }
+  }
+
+  auto result = std::make_shared<SCITREE_ENGINE>();
+
+  if (best != nullptr) {
+    auto engine_or = best->CreateEngine(res.model.get());
+    if (engine_or.ok()) {
+      result->engine = std::move(engine_or).value();
+      result->name = best->name();
+    } else {
+      error.status = true;
+      error.reason = "Unable to build serving engine: " +
+                     std::string(engine_or.status().message());
+    }
+  }
+
+  if (result->engine == nullptr && flat_allowed) {
+    auto flat_error = scitree::flat::build_engine(*res.model, &result->engine);
+    if (!flat_error.status) {
+      result->name = flat_name;
+      error = scitree::nif::SCITREE_ERROR();
+    } else if (!error.status) {
+      error = flat_error;
+    }
+  }
+
+  if (result->engine == nullptr) {
+    if (!error.status) {
+      error.status = true;
+      error.reason = "No compatible serving engine matches the selection.";
+    }
+    return error;
+  }
+
+  scitree::examples::build_feature_index(*res.model, *result->engine, res.dictionaries,
+                                          &result->features);
+  *serving = std::move(result);
+
+  return error;
+}
+
+// Returns the engine of the model, compiling it on the first call.
+// Concurrent callers wait for the same compilation instead of
+// building their own engine.
+scitree::nif::SCITREE_ERROR get_serving(
+  SCITREE_MODEL* res,
+  std::shared_ptr<const SCITREE_ENGINE>* serving
+) {
+  scitree::nif::SCITREE_ERROR error;
+  std::lock_guard<std::mutex> lock(res->engine_mutex);
+
+  if (!res->serving) {
+    scitree::stats::SCITREE_TIMER timer(scitree::stats::ENGINE_BUILD);
+    error = build_engine(*res, &res->serving);
+    if (error.status)
+      return error;
+  }
+
+  *serving = res->serving;
+
+  return error;
+}
+
+// Whether the engine of the model is compiled. A compilation in
+// progress counts as not compiled: callers on a normal scheduler
+// then move to a dirty one rather than wait for it.
+bool serving_ready(SCITREE_MODEL* res) {
+  std::unique_lock<std::mutex> lock(res->engine_mutex, std::try_to_lock);
+  return lock.owns_lock() && res->serving != nullptr;
+}
+
+// Same as get_serving, for the callers that only need the engine.
+// The returned pointer keeps the whole SCITREE_ENGINE alive.
+scitree::nif::SCITREE_ERROR get_engine(
+  SCITREE_MODEL* res,
+  std::shared_ptr<const ygg::serving::FastEngine>* engine
+) {
+  std::shared_ptr<const SCITREE_ENGINE> serving;
+  auto error = get_serving(res, &serving);
+
+  if (!error.status)
+    *engine = std::shared_ptr<const ygg::serving::FastEngine>(serving, serving->engine.get());
+
+  return error;
+}
+
+// Returns the flattened forest of the model, which can stop after
+// any tree: the serving engine when it is the flattened forest, an
+// engine compiled on the first call otherwise. The engine of
+// yggdrasil is neither needed nor built.
+scitree::nif::SCITREE_ERROR get_flat(
+  SCITREE_MODEL* res,
+  std::shared_ptr<const scitree::flat::SCITREE_FLAT_ENGINE>* flat
+) {
+  scitree::nif::SCITREE_ERROR error;
+  std::lock_guard<std::mutex> lock(res->engine_mutex);
+
+  if (res->serving && res->serving->name == scitree::flat::ENGINE_NAME) {
+    *flat = std::shared_ptr<const scitree::flat::SCITREE_FLAT_ENGINE>(
+        res->serving,
+        static_cast<const scitree::flat::SCITREE_FLAT_ENGINE*>(res->serving->engine.get()));
+    return error;
+  }
+
+  if (!res->flat) {
+    scitree::stats::SCITREE_TIMER timer(scitree::stats::ENGINE_BUILD);
+    auto engine = std::make_shared<scitree::flat::SCITREE_FLAT_ENGINE>();
+    error = engine->compile(*res->model);
+    if (error.status)
+      return error;
+
+    res->flat = std::move(engine);
+  }
+
+  *flat = res->flat;
+
+  return error;
+}
+
+// Whether get_flat returns without compiling, as serving_ready.
+bool flat_ready(SCITREE_MODEL* res) {
+  std::unique_lock<std::mutex> lock(res->engine_mutex, std::try_to_lock);
+  return lock.owns_lock() &&
+         (res->flat != nullptr ||
+          (res->serving != nullptr && res->serving->name == scitree::flat::ENGINE_NAME));
+}
+
+// Forces an engine (when `name` is not empty) and excludes others,
+// then rebuilds the engine of the model. Resources already built on
+// the previous engine keep it. On error, the selection and engine
+// of the model are left unchanged.
+scitree::nif::SCITREE_ERROR select_engine(
+  SCITREE_MODEL* res, const std::string& name,
+  const std::vector<std::string>& excluded
+) {
+  auto error = require_trees(*res);
+  if (error.status)
+    return error;
+
+  std::lock_guard<std::mutex> lock(res->engine_mutex);
+  std::string previous_name = res->engine_name;
+  std::vector<std::string> previous_excluded = res->excluded_engines;
+
+  res->engine_name = name;
+  res->excluded_engines = excluded;
+
+  std::shared_ptr<const SCITREE_ENGINE> serving;
+  scitree::stats::SCITREE_TIMER timer(scitree::stats::ENGINE_BUILD);
+  error = build_engine(*res, &serving);
+
+  if (error.status) {
+    res->engine_name = std::move(previous_name);
+    res->excluded_engines = std::move(previous_excluded);
+    return error;
+  }
+
+  res->serving = std::move(serving);
+
+  return error;
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,227 @@
+#ifndef SCITREE_SERIALIZE
+#define SCITREE_SERIALIZE
+
+#include "./scitree_nif_helper.hpp"
+
+#include "yggdrasil_decision_forests/model/abstract_model.h"
+#include "yggdrasil_decision_forests/model/model_library.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace scitree
+{
+namespace serialize
+{
+
+namespace ygg = yggdrasil_decision_forests;
+namespace fs = std::filesystem;
+
+// A serialized model is the content of the model directory written
+// by yggdrasil, packed in a single buffer:
+//
+//   "SCITREE1" then, for each file,
+//   u32 path size | path | u64 content size | content
+//
+// Yggdrasil only reads and writes models through a directory, which
+// is staged in a private temporary directory (in /dev/shm when
+// available) and removed right after.
+static const char MAGIC[] = "SCITREE1";
+static const size_t MAGIC_SIZE = sizeof(MAGIC) - 1;
+
+static fs::path make_temp_dir() {
+  std::error_code ec;
+  fs::path base = fs::is_directory("/dev/shm", ec) ? fs::path("/dev/shm")
+                                                   : fs::temp_directory_path(ec);
+  std::string tmpl = (base / "scitree-XXXXXX").string();
+
+  if (mkdtemp(&tmpl[0]) == NULL)
+    return fs::path();
+
+  return fs::path(tmpl);
+}
+
+template <typename T>
+static void write_int(std::string* out, T value) {
+  out->append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+static bool read_int(const char** data, const char* end, T* value) {
+  if (end - *data < static_cast<std::ptrdiff_t>(sizeof(T)))
+    return false;
+
+  std::memcpy(value, *data, sizeof(T));
+  *data += sizeof(T);
+  return true;
+}
+
+// The staging directory is removed whatever happened, errors are
+// ignored as there is nothing left to do about them.
+static void remove_temp_dir(const fs::path& dir) {
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+static bool read_file(const fs::path& path, std::string* content) {
+  std::error_code ec;
+  const auto size = fs::file_size(path, ec);
+  std::ifstream file(path, std::ios::binary);
+  if (ec || !file)
+    return false;
+
+  content->resize(size);
+  file.read(&(*content)[0], size);
+  return static_cast<uintmax_t>(file.gcount()) == size;
+}
+
+static bool write_file(const fs::path& path, const char* data, size_t size) {
+  std::ofstream file(path, std::ios::binary);
+  if (!file)
+    return false;
+
+  file.write(data, size);
+  file.close();
+  return !file.fail();
+}
+
+scitree::nif::SCITREE_ERROR serialize_model(
+  const ygg::model::AbstractModel& model, std::string* out
+) {
+  scitree::nif::SCITREE_ERROR error;
+  fs::path dir = make_temp_dir();
+
+  if (dir.empty()) {
+    error.status = true;
+    error.reason = "Unable to create a temporary directory.";
+    return error;
+  }
+
+  auto status = ygg::model::SaveModel(dir.string(), &model);
+  if (!status.ok()) {
+    remove_temp_dir(dir);
+    error.status = true;
+    error.reason = std::string(status.message());
+    return error;
+  }
+
+  out->assign(MAGIC, MAGIC_SIZE);
+
+  std::error_code ec;
+  fs::recursive_directory_iterator it(dir, ec), end;
+
+  for (; !ec && it != end; it.increment(ec)) {
+    if (!it->is_regular_file(ec)) {
+      if (ec)
+        break;
+      continue;
+    }
+
+    const std::string name = fs::relative(it->path(), dir, ec).string();
+    std::string data;
+
+    if (ec || !read_file(it->path(), &data)) {
+      error.status = true;
+      break;
+    }
+
+    write_int<uint32_t>(out, name.size());
+    out->append(name);
+    write_int<uint64_t>(out, data.size());
+    out->append(data);
+  }
+
+  remove_temp_dir(dir);
+
+  if (ec || error.status) {
+    out->clear();
+    error.status = true;
+    error.reason = "Unable to read the model from its temporary directory.";
+  }
+
+  return error;
+}
+
+scitree::nif::SCITREE_ERROR deserialize_model(
+  const char* data, size_t size,
+  std::unique_ptr<ygg::model::AbstractModel>* model
+) {
+  scitree::nif::SCITREE_ERROR error;
+  const char* end = data + size;
+
+  if (size < MAGIC_SIZE || std::memcmp(data, MAGIC, MAGIC_SIZE) != 0) {
+    error.status = true;
+    error.reason = "Invalid serialized model.";
+    return error;
+  }
+  data += MAGIC_SIZE;
+
+  fs::path dir = make_temp_dir();
+
+  if (dir.empty()) {
+    error.status = true;
+    error.reason = "Unable to create a temporary directory.";
+    return error;
+  }
+
+  while (data < end) {
+    uint32_t name_size;
+    uint64_t content_size;
+
+    if (!read_int(&data, end, &name_size) || static_cast<uint64_t>(end - data) < name_size) {
+      error.status = true;
+      break;
+    }
+    const fs::path name(std::string(data, name_size));
+    data += name_size;
+
+    if (!read_int(&data, end, &content_size) ||
+        static_cast<uint64_t>(end - data) < content_size) {
+      error.status = true;
+      break;
+    }
+
+    // Files must stay inside the staging directory.
+    if (name.is_absolute() || name.lexically_normal().string().rfind("..", 0) == 0) {
+      error.status = true;
+      break;
+    }
+
+    const fs::path path = dir / name;
+    std::error_code ec;
+    fs::create_directories(path.parent_path(), ec);
+
+    if (ec || !write_file(path, data, content_size)) {
+      remove_temp_dir(dir);
+      error.status = true;
+      error.reason = "Unable to write the model to its temporary directory.";
+      return error;
+    }
+    data += content_size;
+  }
+
+  if (error.status) {
+    remove_temp_dir(dir);
+    error.reason = "Invalid serialized model.";
+    return error;
+  }
+
+  auto status = ygg::model::LoadModel(dir.string(), model);
+  remove_temp_dir(dir);
+
+  if (!status.ok()) {
+    error.status = true;
+    error.reason = std::string(status.message());
+  }
+
+  return error;
+}
+
+}
+}
+
+#endif
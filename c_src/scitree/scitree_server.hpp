@@ -0,0 +1,325 @@
+#ifndef SCITREE_SERVER
+#define SCITREE_SERVER
+
+#include "./scitree_dataset.hpp"
+#include "./scitree_examples.hpp"
+#include "./scitree_nif_helper.hpp"
+#include "./scitree_predict.hpp"
+#include "./scitree_resource.hpp"
+#include "./scitree_stats.hpp"
+
+#include "yggdrasil_decision_forests/serving/example_set.h"
+#include "yggdrasil_decision_forests/serving/fast_engine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <erl_nif.h>
+
+namespace scitree
+{
+namespace server
+{
+
+namespace ygg = yggdrasil_decision_forests;
+
+// A prediction waiting in the queue of a server. The dataset is
+// copied in the environment of the reply, so packed columns stay
+// valid until the request is answered. The request holds a
+// reference on the server resource until it is answered, so a
+// server is never collected while a caller waits for a reply.
+struct SCITREE_REQUEST {
+  ErlNifPid pid;
+  ErlNifEnv* env = nullptr;
+  ERL_NIF_TERM ref;
+  void* server = nullptr;
+  std::vector<scitree::dataset::SCITREE_COLUMN> columns;
+  int num_row = 0;
+  std::chrono::steady_clock::time_point arrival;
+};
+
+// State of the batching thread of a server. The thread shares it
+// with the resource, so the resource can be collected without
+// waiting for the thread, which exits on its own once stopped.
+struct SCITREE_BATCHER {
+  std::shared_ptr<const scitree::resource::SCITREE_ENGINE> serving;
+  const ygg::serving::FastEngine* engine = nullptr;
+  std::unique_ptr<ygg::serving::AbstractExampleSet> examples;
+  ygg::model::proto::Task task;
+  int max_rows = 0;
+  std::chrono::microseconds window{0};
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<SCITREE_REQUEST> queue;
+  int queued_rows = 0;
+  bool stopping = false;
+};
+
+// Micro-batching prediction server. Requests are queued by the
+// callers and a native thread scores them together with a single
+// call to the engine, once `max_rows` rows are queued or `window`
+// has elapsed since the oldest request arrived.
+struct SCITREE_SERVER {
+  scitree::resource::SCITREE_MODEL* model;
+  std::shared_ptr<SCITREE_BATCHER> batcher;
+  std::thread thread;
+};
+
+// Batching thread of a collected server. Its state expires once the
+// thread is about to exit.
+struct SCITREE_STOPPED {
+  std::thread thread;
+  std::weak_ptr<SCITREE_BATCHER> batcher;
+};
+
+// Batching threads of the collected servers, joined once they have
+// exited and all of them when the library is unloaded, so no thread
+// outlives the library.
+static std::mutex stopped_mutex;
+static std::vector<SCITREE_STOPPED> stopped;
+
+// Joins the stopped batching threads that have exited, or all of
+// them when `all` is set.
+void join_stopped(bool all) {
+  std::vector<SCITREE_STOPPED> exited;
+  {
+    std::lock_guard<std::mutex> lock(stopped_mutex);
+    auto running = std::partition(stopped.begin(), stopped.end(), [all](const auto& entry) {
+      return !all && !entry.batcher.expired();
+    });
+    std::move(running, stopped.end(), std::back_inserter(exited));
+    stopped.erase(running, stopped.end());
+  }
+
+  for (auto& entry : exited)
+    entry.thread.join();
+}
+
+// Sends {scitree_prediction, Ref, Result} to the caller of the
+// request, releases its environment and its reference on the
+// server, which may collect the server.
+static void reply(SCITREE_REQUEST* request, ERL_NIF_TERM result) {
+  ERL_NIF_TERM msg = enif_make_tuple3(
+      request->env, enif_make_atom(request->env, "scitree_prediction"), request->ref, result);
+
+  enif_send(NULL, &request->pid, request->env, msg);
+  enif_free_env(request->env);
+  request->env = nullptr;
+
+  if (request->server != nullptr) {
+    enif_release_resource(request->server);
+    request->server = nullptr;
+  }
+}
+
+// Writes every request of the batch in the example set, scores them
+// with one call to the engine and answers each caller with its rows.
+static void score_batch(SCITREE_BATCHER* batcher, std::vector<SCITREE_REQUEST>* batch,
+                        std::vector<float>* predictions) {
+  const int dims = batcher->engine->NumPredictionDimension();
+  std::vector<int> offsets;
+  int num_row = 0;
+
+  scitree::stats::SCITREE_TIMER write_timer(scitree::stats::WRITE_EXAMPLES);
+  for (auto& request : *batch) {
+    auto error = scitree::examples::write_examples(batcher->serving->features, *batcher->engine,
+                                                   request.columns, batcher->examples.get(),
+                                                   num_row);
+    if (error.status) {
+      reply(&request, scitree::nif::error(request.env, error.reason.c_str()));
+      offsets.push_back(-1);
+      continue;
+    }
+
+    offsets.push_back(num_row);
+    num_row += request.num_row;
+  }
+
+  write_timer.stop();
+
+  if (num_row > 0) {
+    scitree::stats::SCITREE_TIMER predict_timer(scitree::stats::PREDICT);
+    batcher->engine->Predict(*batcher->examples, num_row, predictions);
+    scitree::stats::add(scitree::stats::ROWS_PREDICTED, num_row);
+  }
+
+  for (size_t i = 0; i < batch->size(); i++) {
+    auto& request = (*batch)[i];
+    if (offsets[i] < 0)
+      continue;
+
+    const auto begin = predictions->begin() + offsets[i] * dims;
+    const std::vector<float> rows(begin, begin + request.num_row * dims);
+
+    ERL_NIF_TERM binary = scitree::predict::make_predictions(request.env, batcher->task, rows);
+    reply(&request, enif_make_tuple3(request.env, scitree::nif::ok(request.env), binary,
+                                     enif_make_int(request.env, dims)));
+  }
+}
+
+// Answers the requests still queued when the server is stopped.
+static void drain(SCITREE_BATCHER* batcher) {
+  std::deque<SCITREE_REQUEST> queue;
+  {
+    std::lock_guard<std::mutex> lock(batcher->mutex);
+    queue.swap(batcher->queue);
+    batcher->queued_rows = 0;
+  }
+
+  for (auto& request : queue)
+    reply(&request, scitree::nif::error(request.env, "The server was stopped."));
+}
+
+static void run_batcher(std::shared_ptr<SCITREE_BATCHER> batcher) {
+  std::vector<SCITREE_REQUEST> batch;
+  std::vector<float> predictions;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(batcher->mutex);
+      batcher->cv.wait(lock, [&batcher] { return batcher->stopping || !batcher->queue.empty(); });
+      if (batcher->stopping)
+        break;
+
+      const auto deadline = batcher->queue.front().arrival + batcher->window;
+      batcher->cv.wait_until(lock, deadline, [&batcher] {
+        return batcher->stopping || batcher->queued_rows >= batcher->max_rows;
+      });
+      if (batcher->stopping)
+        break;
+
+      // Requests are never larger than max_rows, so at least one
+      // request is taken.
+      int num_row = 0;
+      while (!batcher->queue.empty() &&
+             num_row + batcher->queue.front().num_row <= batcher->max_rows) {
+        num_row += batcher->queue.front().num_row;
+        batch.push_back(std::move(batcher->queue.front()));
+        batcher->queue.pop_front();
+      }
+      batcher->queued_rows -= num_row;
+    }
+
+    score_batch(batcher.get(), &batch, &predictions);
+    batch.clear();
+  }
+
+  drain(batcher.get());
+}
+
+SCITREE_SERVER* alloc_server(ErlNifResourceType* type,
+                             scitree::resource::SCITREE_MODEL* model,
+                             std::shared_ptr<const scitree::resource::SCITREE_ENGINE> serving,
+                             int max_rows, int window_us) {
+  void* mem = enif_alloc_resource(type, sizeof(SCITREE_SERVER));
+  if (mem == NULL)
+    return NULL;
+
+  SCITREE_SERVER* res = new (mem) SCITREE_SERVER();
+  enif_keep_resource(model);
+  res->model = model;
+
+  auto batcher = std::make_shared<SCITREE_BATCHER>();
+  batcher->engine = serving->engine.get();
+  batcher->serving = std::move(serving);
+  batcher->examples = batcher->engine->AllocateExamples(max_rows);
+  batcher->task = model->model->task();
+  batcher->max_rows = max_rows;
+  batcher->window = std::chrono::microseconds(window_us);
+
+  res->batcher = batcher;
+  res->thread = std::thread(run_batcher, std::move(batcher));
+
+  return res;
+}
+
+// Destructor of the resource type. Queued requests hold a reference
+// on the server, so the queue is empty by now. The batching thread
+// is stopped but not joined here, as the destructor may run on a
+// scheduler or on the batching thread itself (when it answers the
+// last request): it is handed to `stopped` and frees the state it
+// shares with the resource once it exits.
+void free_server(ErlNifEnv* env, void* obj) {
+  SCITREE_SERVER* res = static_cast<SCITREE_SERVER*>(obj);
+
+  {
+    std::lock_guard<std::mutex> lock(res->batcher->mutex);
+    res->batcher->stopping = true;
+  }
+  res->batcher->cv.notify_all();
+
+  join_stopped(false);
+  {
+    std::lock_guard<std::mutex> lock(stopped_mutex);
+    stopped.push_back({std::move(res->thread), res->batcher});
+  }
+
+  res->batcher.reset();
+  enif_release_resource(res->model);
+
+  res->~SCITREE_SERVER();
+}
+
+// Decodes the dataset of a request and queues it. The caller
+// receives the predictions in a {scitree_prediction, Ref, Result}
+// message.
+scitree::nif::SCITREE_ERROR submit(SCITREE_SERVER* server, ErlNifEnv* env,
+                                   ERL_NIF_TERM data, ERL_NIF_TERM ref) {
+  scitree::nif::SCITREE_ERROR error;
+  SCITREE_REQUEST request;
+
+  enif_self(env, &request.pid);
+  request.env = enif_alloc_env();
+  request.ref = enif_make_copy(request.env, ref);
+
+  std::vector<ERL_NIF_TERM> dataset;
+  ERL_NIF_TERM copy = enif_make_copy(request.env, data);
+
+  if (!scitree::nif::get_list(request.env, copy, dataset)) {
+    enif_free_env(request.env);
+    error.status = true;
+    error.reason = "Empty or invalid dataset.";
+    return error;
+  }
+
+  error = scitree::dataset::decode_columns(request.env, dataset.data(), dataset.size(),
+                                           &request.columns);
+  if (error.status) {
+    enif_free_env(request.env);
+    return error;
+  }
+
+  request.num_row = request.columns.empty() ? 0 : request.columns[0].length;
+  if (request.num_row > server->batcher->max_rows) {
+    enif_free_env(request.env);
+    error.status = true;
+    error.reason = "The dataset has more rows than the server batches.";
+    return error;
+  }
+
+  request.arrival = std::chrono::steady_clock::now();
+  enif_keep_resource(server);
+  request.server = server;
+
+  auto* batcher = server->batcher.get();
+  {
+    std::lock_guard<std::mutex> lock(batcher->mutex);
+    batcher->queued_rows += request.num_row;
+    batcher->queue.push_back(std::move(request));
+  }
+  batcher->cv.notify_one();
+
+  return error;
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef SCITREE_STATS
+#define SCITREE_STATS
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <erl_nif.h>
+
+namespace scitree
+{
+namespace stats
+{
+
+// Phases of the NIFs whose time is accumulated.
+enum PHASE {
+  DECODE,          // Erlang terms to columns
+  SPEC,            // dataspec inference while training
+  DATASET,         // columns to VerticalDataset
+  ENGINE_BUILD,    // BuildFastEngine
+  COPY_EXAMPLES,   // VerticalDataset to example set
+  WRITE_EXAMPLES,  // columns or maps to example set, without dataset
+  PREDICT,         // FastEngine::Predict
+  RESULT,          // predictions to Erlang terms
+  TRAIN,           // learner training
+  NUM_PHASES
+};
+
+static const char* const PHASE_NAMES[NUM_PHASES] = {
+    "decode", "spec", "dataset", "engine_build", "copy_examples",
+    "write_examples", "predict", "result", "train"};
+
+enum COUNTER {
+  ROWS_DECODED,
+  BYTES_DECODED,  // bytes of packed binary columns
+  ROWS_PREDICTED,
+  BYTES_RETURNED,
+  ROWS_TRAINED,
+  NUM_COUNTERS
+};
+
+static const char* const COUNTER_NAMES[NUM_COUNTERS] = {
+    "rows_decoded", "bytes_decoded", "rows_predicted", "bytes_returned", "rows_trained"};
+
+// Accumulators are striped over cache-line aligned shards, each
+// thread (in practice each scheduler) updating its own shard with
+// relaxed atomics; shards are only summed when the stats are read.
+static const unsigned int NUM_SHARDS = 64;
+
+struct alignas(64) SCITREE_SHARD {
+  std::atomic<uint64_t> calls[NUM_PHASES];
+  std::atomic<uint64_t> nanoseconds[NUM_PHASES];
+  std::atomic<uint64_t> counters[NUM_COUNTERS];
+};
+
+static SCITREE_SHARD shards[NUM_SHARDS];
+
+inline SCITREE_SHARD& shard() {
+  static std::atomic<unsigned int> next_shard{0};
+  thread_local unsigned int index = next_shard++ % NUM_SHARDS;
+  return shards[index];
+}
+
+inline void record(PHASE phase, uint64_t nanoseconds) {
+  SCITREE_SHARD& s = shard();
+  s.calls[phase].fetch_add(1, std::memory_order_relaxed);
+  s.nanoseconds[phase].fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+inline void add(COUNTER counter, uint64_t value) {
+  shard().counters[counter].fetch_add(value, std::memory_order_relaxed);
+}
+
+// Records the time spent in a phase from its construction to its
+// destruction (or to stop()).
+class SCITREE_TIMER {
+ public:
+  explicit SCITREE_TIMER(PHASE phase)
+      : phase_(phase), start_(std::chrono::steady_clock::now()) {}
+
+  ~SCITREE_TIMER() { stop(); }
+
+  void stop() {
+    if (stopped_)
+      return;
+
+    stopped_ = true;
+    const auto elapsed = std::chrono::steady_clock::now() - start_;
+    record(phase_, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  }
+
+ private:
+  PHASE phase_;
+  std::chrono::steady_clock::time_point start_;
+  bool stopped_ = false;
+};
+
+// Sum of the shards as a map:
+//   %{phases: %{decode: %{calls: n, nanoseconds: n}, ...}, counters: %{rows_decoded: n, ...}}
+ERL_NIF_TERM make_stats(ErlNifEnv* env) {
+  ERL_NIF_TERM phases = enif_make_new_map(env);
+  ERL_NIF_TERM counters = enif_make_new_map(env);
+
+  for (int phase = 0; phase < NUM_PHASES; phase++) {
+    uint64_t calls = 0, nanoseconds = 0;
+    for (const auto& s : shards) {
+      calls += s.calls[phase].load(std::memory_order_relaxed);
+      nanoseconds += s.nanoseconds[phase].load(std::memory_order_relaxed);
+    }
+
+    ERL_NIF_TERM entry = enif_make_new_map(env);
+    enif_make_map_put(env, entry, enif_make_atom(env, "calls"), enif_make_uint64(env, calls), &entry);
+    enif_make_map_put(env, entry, enif_make_atom(env, "nanoseconds"),
+                      enif_make_uint64(env, nanoseconds), &entry);
+    enif_make_map_put(env, phases, enif_make_atom(env, PHASE_NAMES[phase]), entry, &phases);
+  }
+
+  for (int counter = 0; counter < NUM_COUNTERS; counter++) {
+    uint64_t value = 0;
+    for (const auto& s : shards)
+      value += s.counters[counter].load(std::memory_order_relaxed);
+
+    enif_make_map_put(env, counters, enif_make_atom(env, COUNTER_NAMES[counter]),
+                      enif_make_uint64(env, value), &counters);
+  }
+
+  ERL_NIF_TERM stats = enif_make_new_map(env);
+  enif_make_map_put(env, stats, enif_make_atom(env, "phases"), phases, &stats);
+  enif_make_map_put(env, stats, enif_make_atom(env, "counters"), counters, &stats);
+
+  return stats;
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,403 @@
+#ifndef SCITREE_TUNER
+#define SCITREE_TUNER
+
+#include "./scitree_concurrency.hpp"
+#include "./scitree_learner.hpp"
+#include "./scitree_nif_helper.hpp"
+
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
+#include "yggdrasil_decision_forests/metric/metric.h"
+#include "yggdrasil_decision_forests/metric/metric.pb.h"
+#include "yggdrasil_decision_forests/model/abstract_model.h"
+#include "yggdrasil_decision_forests/model/gradient_boosted_trees/gradient_boosted_trees.h"
+#include "yggdrasil_decision_forests/model/random_forest/random_forest.h"
+#include "yggdrasil_decision_forests/utils/random.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <erl_nif.h>
+
+namespace scitree
+{
+namespace tuner
+{
+
+namespace ygg = yggdrasil_decision_forests;
+namespace metric = yggdrasil_decision_forests::metric;
+
+// Candidate values of a hyper-parameter.
+struct SCITREE_SEARCH_SPACE {
+  std::string name;
+  std::vector<scitree::nif::SCITREE_HPARAM> candidates;
+};
+
+// A configuration of the search, with its score on the validation
+// rows once trained: the accuracy for classification, the RMSE for
+// regression. `stopped` is set when the model has fewer trees than
+// requested, i.e. its training was cut by the time budget of the
+// trials or by early stopping.
+struct SCITREE_TRIAL {
+  std::vector<scitree::nif::SCITREE_HPARAM> hyper_params;
+  std::unique_ptr<ygg::model::AbstractModel> model;
+  scitree::nif::SCITREE_ERROR error;
+  double score = 0;
+  double seconds = 0;
+  int num_threads = 0;
+  bool stopped = false;
+};
+
+// Reads a search space given as a list of {name, [value]} tuples.
+scitree::nif::SCITREE_ERROR get_search_space(ErlNifEnv* env, ERL_NIF_TERM term,
+                                             std::vector<SCITREE_SEARCH_SPACE>* space) {
+  scitree::nif::SCITREE_ERROR error;
+  std::vector<ERL_NIF_TERM> items;
+
+  if (!scitree::nif::get_list(env, term, items) || items.empty()) {
+    error.status = true;
+    error.reason = "Empty or invalid search space.";
+    return error;
+  }
+
+  for (ERL_NIF_TERM item : items) {
+    const ERL_NIF_TERM* tuple;
+    int arity;
+    SCITREE_SEARCH_SPACE hparam;
+    std::vector<ERL_NIF_TERM> values;
+
+    if (!enif_get_tuple(env, item, &arity, &tuple) || arity != 2 ||
+        !(scitree::nif::get_atom(env, tuple[0], hparam.name) ||
+          scitree::nif::get(env, tuple[0], hparam.name)) ||
+        !scitree::nif::get_list(env, tuple[1], values) || values.empty()) {
+      error.status = true;
+      error.reason = "The search space must map names to lists of values.";
+      return error;
+    }
+
+    for (ERL_NIF_TERM value : values) {
+      scitree::nif::SCITREE_HPARAM candidate;
+      candidate.name = hparam.name;
+
+      if (!scitree::nif::get_hparam(env, value, &candidate)) {
+        error.status = true;
+        error.reason = "Invalid value for hyper-parameter " + hparam.name + ".";
+        return error;
+      }
+
+      hparam.candidates.push_back(candidate);
+    }
+
+    space->push_back(std::move(hparam));
+  }
+
+  return error;
+}
+
+// Picks the configurations to try: the whole grid when it has at
+// most `num_trials` configurations, `num_trials` distinct random
+// configurations otherwise.
+std::vector<SCITREE_TRIAL> make_trials(const std::vector<SCITREE_SEARCH_SPACE>& space,
+                                       int num_trials, int seed) {
+  double grid_size = 1;
+  for (const auto& hparam : space)
+    grid_size *= hparam.candidates.size();
+
+  std::vector<std::vector<size_t>> picks;
+
+  if (grid_size <= num_trials) {
+    std::vector<size_t> pick(space.size(), 0);
+
+    for (int i = 0; i < grid_size; i++) {
+      picks.push_back(pick);
+
+      for (size_t h = 0; h < space.size() && ++pick[h] == space[h].candidates.size(); h++)
+        pick[h] = 0;
+    }
+  } else {
+    std::mt19937 rnd(seed);
+    std::set<std::vector<size_t>> seen;
+
+    while (static_cast<int>(picks.size()) < num_trials) {
+      std::vector<size_t> pick(space.size());
+      for (size_t h = 0; h < space.size(); h++)
+        pick[h] = std::uniform_int_distribution<size_t>(0, space[h].candidates.size() - 1)(rnd);
+
+      if (seen.insert(pick).second)
+        picks.push_back(std::move(pick));
+    }
+  }
+
+  std::vector<SCITREE_TRIAL> trials(picks.size());
+  for (size_t i = 0; i < picks.size(); i++) {
+    for (size_t h = 0; h < space.size(); h++)
+      trials[i].hyper_params.push_back(space[h].candidates[picks[i][h]]);
+  }
+
+  return trials;
+}
+
+// Holds out a random `validation_ratio` of the rows of the dataset
+// to score the trials, the other rows are trained on.
+scitree::nif::SCITREE_ERROR split_dataset(
+  const ygg::dataset::VerticalDataset& dataset, double validation_ratio, int seed,
+  ygg::dataset::VerticalDataset* train, ygg::dataset::VerticalDataset* validation
+) {
+  scitree::nif::SCITREE_ERROR error;
+  using row_t = ygg::dataset::VerticalDataset::row_t;
+
+  std::vector<row_t> rows(dataset.nrow());
+  std::iota(rows.begin(), rows.end(), 0);
+  std::shuffle(rows.begin(), rows.end(), std::mt19937(seed));
+
+  const size_t num_validation =
+      std::max<size_t>(1, std::llround(validation_ratio * dataset.nrow()));
+
+  if (validation_ratio <= 0 || validation_ratio >= 1 || num_validation >= rows.size()) {
+    error.status = true;
+    error.reason = "Unable to hold out validation rows, check the validation ratio.";
+    return error;
+  }
+
+  // Rows are extracted in order, for locality.
+  std::vector<row_t> validation_rows(rows.begin(), rows.begin() + num_validation);
+  std::vector<row_t> train_rows(rows.begin() + num_validation, rows.end());
+  std::sort(validation_rows.begin(), validation_rows.end());
+  std::sort(train_rows.begin(), train_rows.end());
+
+  auto train_or = dataset.Extract(train_rows);
+  auto validation_or = dataset.Extract(validation_rows);
+
+  if (!train_or.ok() || !validation_or.ok()) {
+    error.status = true;
+    const auto& status = train_or.ok() ? validation_or.status() : train_or.status();
+    error.reason = std::string(status.message());
+    return error;
+  }
+
+  *train = std::move(train_or).value();
+  *validation = std::move(validation_or).value();
+
+  return error;
+}
+
+// Boosting iterations (trees of random forests) the config asks
+// for: its num_trees hyper-parameter or the default of the learner,
+// -1 when the learner has none.
+int64_t requested_trees(const scitree::nif::SCITREE_CONFIG& config) {
+  for (const auto& hparam : config.options.hyper_params) {
+    if (hparam.name == "num_trees" && hparam.type == scitree::nif::SCITREE_HPARAM::INTEGER)
+      return hparam.integer;
+  }
+
+  std::unique_ptr<ygg::model::AbstractLearner> learner;
+  if (scitree::learner::make_learner(config, &learner).status)
+    return -1;
+
+  auto spec_or = learner->GetGenericHyperParameterSpecification();
+  if (!spec_or.ok())
+    return -1;
+
+  const auto field = spec_or.value().fields().find("num_trees");
+  if (field == spec_or.value().fields().end() || !field->second.has_integer())
+    return -1;
+
+  return field->second.integer().default_value();
+}
+
+// Boosting iterations (trees of random forests) of the model, -1
+// for the other models.
+int64_t trained_trees(const ygg::model::AbstractModel& model) {
+  namespace gbt = yggdrasil_decision_forests::model::gradient_boosted_trees;
+  namespace rf = yggdrasil_decision_forests::model::random_forest;
+
+  if (const auto* boosted = dynamic_cast<const gbt::GradientBoostedTreesModel*>(&model))
+    return boosted->decision_trees().size() / boosted->num_trees_per_iter();
+  if (const auto* forest = dynamic_cast<const rf::RandomForestModel*>(&model))
+    return forest->decision_trees().size();
+
+  return -1;
+}
+
+// Trains and scores a trial. Its hyper-parameters override the ones
+// of the config with the same name.
+void run_trial(const scitree::nif::SCITREE_CONFIG& base,
+               const ygg::dataset::VerticalDataset& train,
+               const ygg::dataset::VerticalDataset& validation,
+               double max_trial_seconds, SCITREE_TRIAL* trial) {
+  scitree::nif::SCITREE_CONFIG config = base;
+
+  for (const auto& hparam : trial->hyper_params)
+    scitree::learner::set_hyper_param(&config.options, hparam);
+
+  if (max_trial_seconds > 0)
+    config.options.maximum_training_duration_seconds = max_trial_seconds;
+
+  if (trial->num_threads > 0)
+    config.num_threads = trial->num_threads;
+
+  const auto start = std::chrono::steady_clock::now();
+  trial->error = scitree::learner::train(config, train, &trial->model);
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  trial->seconds = std::chrono::duration<double>(elapsed).count();
+
+  if (trial->error.status)
+    return;
+
+  const int64_t requested = requested_trees(config);
+  const int64_t trained = trained_trees(*trial->model);
+  trial->stopped = requested > 0 && trained >= 0 && trained < requested;
+
+  metric::proto::EvaluationOptions options;
+  options.set_task(trial->model->task());
+
+  ygg::utils::RandomEngine rnd(config.options.random_seed);
+  const auto eval = trial->model->Evaluate(validation, options, &rnd);
+  trial->score = trial->model->task() == ygg::model::proto::Task::CLASSIFICATION
+                     ? metric::Accuracy(eval)
+                     : metric::RMSE(eval);
+}
+
+// Runs the trials on a pool of their own, so they never hold the
+// workers of ingestion and predictions, and returns the index of
+// the best one. Each worker trains one trial at a time. Unless the
+// config sets the threads of the learner, the cores are shared
+// between the trials as they start: a trial takes its share of the
+// cores left free by the running ones, so the cores of the trials
+// that end early (e.g. early stopping or the time budget) go to the
+// next ones.
+scitree::nif::SCITREE_ERROR tune(
+  const scitree::nif::SCITREE_CONFIG& config,
+  const ygg::dataset::VerticalDataset& train,
+  const ygg::dataset::VerticalDataset& validation,
+  double max_trial_seconds,
+  std::vector<SCITREE_TRIAL>* trials, size_t* best
+) {
+  scitree::nif::SCITREE_ERROR error;
+
+  if (config.task != ygg::model::proto::Task::CLASSIFICATION &&
+      config.task != ygg::model::proto::Task::REGRESSION) {
+    error.status = true;
+    error.reason = "Tuning is only supported for classification and regression.";
+    return error;
+  }
+
+  const int cores = std::max(1u, std::thread::hardware_concurrency());
+  const size_t concurrent = std::max<size_t>(1, std::min<size_t>(trials->size(), cores));
+
+  std::mutex mutex;
+  size_t started = 0;
+  size_t running = 0;
+  int free_cores = cores;
+
+  const std::function<void(size_t)> run = [&](size_t i) {
+    SCITREE_TRIAL* trial = &(*trials)[i];
+    int threads = 0;
+
+    if (config.num_threads <= 0) {
+      std::lock_guard<std::mutex> lock(mutex);
+      // The free cores are split between this trial and the trials
+      // the idle workers are about to start.
+      const size_t waiting = trials->size() - ++started;
+      const size_t starting = 1 + std::min(waiting, concurrent - running - 1);
+      threads = std::max<int>(1, free_cores / static_cast<int>(starting));
+      free_cores -= threads;
+      running++;
+    }
+
+    trial->num_threads = threads;
+    run_trial(config, train, validation, max_trial_seconds, trial);
+
+    if (config.num_threads <= 0) {
+      std::lock_guard<std::mutex> lock(mutex);
+      free_cores += threads;
+      running--;
+    }
+  };
+
+  // The calling thread trains trials too.
+  scitree::concurrency::SCITREE_POOL pool;
+  if (concurrent > 1)
+    scitree::concurrency::start_pool(&pool, concurrent - 1);
+  scitree::concurrency::parallel_for(&pool, trials->size(), run);
+  scitree::concurrency::stop_pool(&pool);
+
+  const bool lower_is_better = config.task == ygg::model::proto::Task::REGRESSION;
+  bool found = false;
+
+  for (size_t i = 0; i < trials->size(); i++) {
+    const auto& trial = (*trials)[i];
+    if (trial.error.status)
+      continue;
+
+    const double best_score = found ? (*trials)[*best].score : 0;
+    if (!found || (lower_is_better ? trial.score < best_score : trial.score > best_score)) {
+      *best = i;
+      found = true;
+    }
+  }
+
+  if (!found)
+    return (*trials)[0].error;
+
+  return error;
+}
+
+// Score table of the trials, one map per trial:
+//   %{hyper_params: [{name, value}], score: f, seconds: f, stopped: bool, error: nil | reason}
+ERL_NIF_TERM make_score_table(ErlNifEnv* env, const std::vector<SCITREE_TRIAL>& trials) {
+  std::vector<ERL_NIF_TERM> rows;
+
+  for (const auto& trial : trials) {
+    std::vector<ERL_NIF_TERM> hyper_params;
+
+    for (const auto& hparam : trial.hyper_params) {
+      ERL_NIF_TERM value;
+
+      switch (hparam.type) {
+        case scitree::nif::SCITREE_HPARAM::INTEGER:
+          value = enif_make_int64(env, hparam.integer);
+          break;
+        case scitree::nif::SCITREE_HPARAM::REAL:
+          value = enif_make_double(env, hparam.real_value);
+          break;
+        default:
+          value = enif_make_string(env, hparam.categorical.c_str(), ERL_NIF_LATIN1);
+      }
+
+      hyper_params.push_back(
+          enif_make_tuple2(env, enif_make_atom(env, hparam.name.c_str()), value));
+    }
+
+    ERL_NIF_TERM keys[] = {
+        enif_make_atom(env, "hyper_params"), enif_make_atom(env, "score"),
+        enif_make_atom(env, "seconds"), enif_make_atom(env, "stopped"),
+        enif_make_atom(env, "error")};
+    ERL_NIF_TERM values[] = {
+        enif_make_list_from_array(env, hyper_params.data(), hyper_params.size()),
+        enif_make_double(env, trial.score),
+        enif_make_double(env, trial.seconds),
+        enif_make_atom(env, trial.stopped ? "true" : "false"),
+        trial.error.status ? enif_make_string(env, trial.error.reason.c_str(), ERL_NIF_LATIN1)
+                           : enif_make_atom(env, "nil")};
+    ERL_NIF_TERM row;
+
+    enif_make_map_from_arrays(env, keys, values, 5, &row);
+    rows.push_back(row);
+  }
+
+  return enif_make_list_from_array(env, rows.data(), rows.size());
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,285 @@
+#ifndef SCITREE_WARMSTART
+#define SCITREE_WARMSTART
+
+#include "./scitree_concurrency.hpp"
+#include "./scitree_learner.hpp"
+#include "./scitree_nif_helper.hpp"
+#include "./scitree_predict.hpp"
+#include "./scitree_serialize.hpp"
+
+#include "yggdrasil_decision_forests/dataset/data_spec.pb.h"
+#include "yggdrasil_decision_forests/dataset/vertical_dataset.h"
+#include "yggdrasil_decision_forests/model/abstract_model.h"
+#include "yggdrasil_decision_forests/model/gradient_boosted_trees/gradient_boosted_trees.h"
+#include "yggdrasil_decision_forests/serving/fast_engine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace scitree
+{
+namespace warmstart
+{
+
+namespace ygg = yggdrasil_decision_forests;
+namespace gbt = yggdrasil_decision_forests::model::gradient_boosted_trees;
+
+// Column of the boosting dataset weighting the working response of
+// binary classification.
+static const char* const WEIGHT_COLUMN = "__scitree_weight";
+
+// Probabilities are kept this far from 0 and 1 when the logits are
+// read back from the predictions of the model, which bounds the
+// working response of the examples the model is sure about.
+static const double MIN_PROBABILITY = 1e-5;
+
+// Copy of the dataset in which each boosting step trains a
+// regression on the label column, turned numerical, weighted by the
+// weight column when `weighted`. The other columns keep their index
+// in the dataspec of the model, so the trees trained on it can be
+// added to the model as is.
+void make_boosting_dataset(const ygg::dataset::proto::DataSpecification& model_spec,
+                           const ygg::dataset::VerticalDataset& source, int label_col_idx,
+                           bool weighted, ygg::dataset::VerticalDataset* dataset) {
+  using ygg::dataset::VerticalDataset;
+  namespace proto = ygg::dataset::proto;
+
+  proto::DataSpecification data_spec = model_spec;
+  auto* label = data_spec.mutable_columns(label_col_idx);
+  label->set_type(proto::ColumnType::NUMERICAL);
+  label->clear_categorical();
+
+  if (weighted) {
+    auto* weights = data_spec.add_columns();
+    weights->set_name(WEIGHT_COLUMN);
+    weights->set_type(proto::ColumnType::NUMERICAL);
+  }
+
+  dataset->set_data_spec(data_spec);
+  dataset->CreateColumnsFromDataspec();
+
+  for (int col_idx = 0; col_idx < data_spec.columns_size(); col_idx++) {
+    if (col_idx == label_col_idx || col_idx >= model_spec.columns_size()) {
+      dataset->mutable_column(col_idx)->Resize(source.nrow());
+    } else if (data_spec.columns(col_idx).type() == proto::ColumnType::NUMERICAL) {
+      *dataset->MutableColumnWithCast<VerticalDataset::NumericalColumn>(col_idx)
+           ->mutable_values() =
+          source.ColumnWithCast<VerticalDataset::NumericalColumn>(col_idx)->values();
+    } else {
+      *dataset->MutableColumnWithCast<VerticalDataset::CategoricalColumn>(col_idx)
+           ->mutable_values() =
+          source.ColumnWithCast<VerticalDataset::CategoricalColumn>(col_idx)->values();
+    }
+  }
+
+  dataset->mutable_data_spec()->set_created_num_rows(source.nrow());
+  dataset->set_nrow(source.nrow());
+}
+
+// Adds the trees of a boosting step, and its initial prediction, to
+// the model.
+void append_step(gbt::GradientBoostedTreesModel* step, gbt::GradientBoostedTreesModel* model) {
+  std::vector<float> initial_predictions = model->initial_predictions();
+  initial_predictions[0] += step->initial_predictions()[0];
+  model->set_initial_predictions(initial_predictions);
+
+  for (auto& tree : *step->mutable_decision_trees())
+    model->mutable_decision_trees()->push_back(std::move(tree));
+}
+
+// Continues the boosting of a gradient boosted trees model on a new
+// dataset, encoded with the dataspec of the model, and returns a copy
+// of the model with up to `extra_trees` more trees. The model itself
+// is left untouched, as other processes may be predicting with it.
+//
+// The learner cannot start from an existing model, so the new trees
+// are trained as regressions on what the model misses: the residuals
+// for the squared error, all trees at once, and for the binomial
+// log-likelihood the Newton working response (y - p) / (p (1 - p))
+// weighted by p (1 - p), one tree at a time so that p is updated
+// with each tree as the learner would.
+scitree::nif::SCITREE_ERROR continue_training(
+  scitree::concurrency::SCITREE_POOL* pool,
+  const scitree::nif::SCITREE_CONFIG& config,
+  const ygg::model::AbstractModel& model,
+  const ygg::serving::FastEngine& engine,
+  const ygg::dataset::VerticalDataset& dataset,
+  int extra_trees,
+  std::unique_ptr<ygg::model::AbstractModel>* extended
+) {
+  using ygg::dataset::VerticalDataset;
+  scitree::nif::SCITREE_ERROR error;
+
+  const auto* base = dynamic_cast<const gbt::GradientBoostedTreesModel*>(&model);
+  if (base == nullptr) {
+    error.status = true;
+    error.reason = "Only gradient boosted trees models can be trained further.";
+    return error;
+  }
+
+  const bool binomial = base->loss() == gbt::proto::Loss::BINOMIAL_LOG_LIKELIHOOD;
+  if (!binomial && base->loss() != gbt::proto::Loss::SQUARED_ERROR) {
+    error.status = true;
+    error.reason = "Only regression and binary classification models can be trained further.";
+    return error;
+  }
+
+  const int label_col_idx = model.label_col_idx();
+  const std::string& label_name = model.data_spec().columns(label_col_idx).name();
+  if (config.label != label_name) {
+    error.status = true;
+    error.reason = "The label of the config is not the label " + label_name + " of the model.";
+    return error;
+  }
+
+  if (extra_trees <= 0) {
+    error.status = true;
+    error.reason = "The number of extra trees must be positive.";
+    return error;
+  }
+
+  const int64_t num_row = dataset.nrow();
+
+  // Labels, as 0/1 for binary classification (the positive class
+  // has index 2), and scores of the model, as logits.
+  std::vector<double> labels(num_row);
+
+  if (binomial) {
+    const auto& values =
+        dataset.ColumnWithCast<VerticalDataset::CategoricalColumn>(label_col_idx)->values();
+    for (int64_t row = 0; row < num_row && !error.status; row++) {
+      error.status = values[row] != 1 && values[row] != 2;
+      labels[row] = values[row] == 2;
+    }
+  } else {
+    const auto& values =
+        dataset.ColumnWithCast<VerticalDataset::NumericalColumn>(label_col_idx)->values();
+    for (int64_t row = 0; row < num_row && !error.status; row++) {
+      error.status = std::isnan(values[row]);
+      labels[row] = values[row];
+    }
+  }
+
+  if (error.status) {
+    error.reason = "The label column " + label_name + " has missing or unknown values.";
+    return error;
+  }
+
+  std::vector<float> predictions;
+  error = scitree::predict::predict_dataset_sharded(pool, engine, dataset, &predictions);
+  if (error.status)
+    return error;
+
+  std::vector<double> scores(num_row);
+  for (int64_t row = 0; row < num_row; row++) {
+    if (binomial) {
+      const double p = std::clamp<double>(predictions[row], MIN_PROBABILITY, 1 - MIN_PROBABILITY);
+      scores[row] = std::log(p / (1 - p));
+    } else {
+      scores[row] = predictions[row];
+    }
+  }
+
+  // The model is copied through its serialized form, its trees
+  // cannot be copied otherwise.
+  std::string serialized;
+  error = scitree::serialize::serialize_model(model, &serialized);
+  if (error.status)
+    return error;
+
+  error = scitree::serialize::deserialize_model(serialized.data(), serialized.size(), extended);
+  if (error.status)
+    return error;
+  auto* result = dynamic_cast<gbt::GradientBoostedTreesModel*>(extended->get());
+
+  VerticalDataset boosting;
+  make_boosting_dataset(model.data_spec(), dataset, label_col_idx, binomial, &boosting);
+  auto* target =
+      boosting.MutableColumnWithCast<VerticalDataset::NumericalColumn>(label_col_idx)
+          ->mutable_values();
+  auto* weights =
+      binomial ? boosting.MutableColumnWithCast<VerticalDataset::NumericalColumn>(
+                              boosting.data_spec().columns_size() - 1)->mutable_values()
+               : nullptr;
+
+  scitree::nif::SCITREE_CONFIG step_config = config;
+  step_config.learner = "GRADIENT_BOOSTED_TREES";
+  step_config.task = ygg::model::proto::Task::REGRESSION;
+
+  const int num_steps = binomial ? extra_trees : 1;
+  scitree::nif::SCITREE_HPARAM hparam;
+
+  hparam.type = scitree::nif::SCITREE_HPARAM::INTEGER;
+  hparam.name = "num_trees";
+  hparam.integer = binomial ? 1 : extra_trees;
+  scitree::learner::set_hyper_param(&step_config.options, hparam);
+
+  hparam.type = scitree::nif::SCITREE_HPARAM::CATEGORICAL;
+  hparam.name = "loss";
+  hparam.categorical = "SQUARED_ERROR";
+  scitree::learner::set_hyper_param(&step_config.options, hparam);
+
+  // A single tree per step leaves nothing to stop early, so all the
+  // rows are trained on.
+  if (binomial) {
+    step_config.weights = WEIGHT_COLUMN;
+
+    hparam.type = scitree::nif::SCITREE_HPARAM::REAL;
+    hparam.name = "validation_ratio";
+    hparam.real_value = 0;
+    scitree::learner::set_hyper_param(&step_config.options, hparam);
+
+    hparam.type = scitree::nif::SCITREE_HPARAM::CATEGORICAL;
+    hparam.name = "early_stopping";
+    hparam.categorical = "NONE";
+    scitree::learner::set_hyper_param(&step_config.options, hparam);
+  }
+
+  for (int step = 0; step < num_steps; step++) {
+    for (int64_t row = 0; row < num_row; row++) {
+      if (binomial) {
+        const double p = std::clamp(1 / (1 + std::exp(-scores[row])), MIN_PROBABILITY,
+                                    1 - MIN_PROBABILITY);
+        (*target)[row] = (labels[row] - p) / (p * (1 - p));
+        (*weights)[row] = p * (1 - p);
+      } else {
+        (*target)[row] = labels[row] - scores[row];
+      }
+    }
+
+    std::unique_ptr<ygg::model::AbstractModel> trained;
+    error = scitree::learner::train(step_config, boosting, &trained);
+    if (error.status)
+      return error;
+    auto* step_model = dynamic_cast<gbt::GradientBoostedTreesModel*>(trained.get());
+
+    if (step + 1 < num_steps) {
+      auto engine_or = step_model->BuildFastEngine();
+      if (!engine_or.ok()) {
+        error.status = true;
+        error.reason = std::string(engine_or.status().message());
+        return error;
+      }
+
+      error = scitree::predict::predict_dataset_sharded(pool, *engine_or.value(), boosting,
+                                                        &predictions);
+      if (error.status)
+        return error;
+
+      for (int64_t row = 0; row < num_row; row++)
+        scores[row] += predictions[row];
+    }
+
+    append_step(step_model, result);
+  }
+
+  return error;
+}
+
+}
+}
+
+#endif
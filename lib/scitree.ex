@@ -3,7 +3,10 @@ defmodule Scitree do
   Scitree is a collection of state-of-the-art algorithms for Decision Forest model algorithms.
   """
 
+  alias Scitree.Binding
+  alias Scitree.Dataset
   alias Scitree.Native
+  alias Scitree.Telemetry
   alias Scitree.Infer
   alias Scitree.Validations, as: Val
   alias Nx
@@ -27,13 +30,131 @@ defmodule Scitree do
       ...> }
       iex> config = Scitree.Config.init() |> Scitree.Config.label("play_tennis")
       iex> Scitree.train(config, data_train)
+
+  A `Scitree.Dataset` may be given instead of the data, to train
+  several times on the same data without ingesting it again.
   """
   def train(config, data) do
-    data = Infer.execute(data)
+    Telemetry.span(:train, %{learner: config.learner}, fn ->
+      case training_data(data, config) do
+        {:ok, data} ->
+          case Native.train(config, data) do
+            {:ok, ref} ->
+              ref
+
+            {:error, reason} ->
+              raise List.to_string(reason)
+          end
+
+        {:error, reason} ->
+          raise reason
+      end
+    end)
+  end
+
+  @doc """
+  Searches the learner hyper-parameters of the config and returns
+  the best model along with the score table of the trials.
+
+  The search space maps hyper-parameter names to their candidate
+  values (lists or ranges). When the grid has at most `:trials`
+  configurations, all of them are tried; otherwise `:trials` random
+  distinct ones are. The data, or a `Scitree.Dataset`, is ingested
+  once and split natively between training and validation rows,
+  and the trials are trained concurrently on native threads of
+  their own, without going back through the VM. A trial that ends
+  early frees its cores for the next ones right away.
+
+  Trials are scored on the validation rows: by accuracy for
+  classification (higher is better), by RMSE for regression (lower
+  is better).
+
+  ## Options
+
+    * `:trials` - maximum number of configurations tried. Defaults to `10`.
+
+    * `:validation_ratio` - ratio of the rows held out to score the
+      trials. Defaults to `0.2`.
+
+    * `:max_trial_seconds` - time budget of the training of a trial.
+      Defaults to no budget. Trials whose model has fewer trees than
+      requested, cut by the budget or by early stopping, are marked
+      as `stopped`.
+
+      {ref, trials} =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.Config.learner(:gradient_boosted_trees)
+        |> Scitree.tune(data_train, %{max_depth: 3..8, shrinkage: [0.05, 0.1, 0.2]}, trials: 12)
+
+      hd(trials)
+      #=> %{hyper_params: [max_depth: 3, shrinkage: 0.05], score: 0.83, seconds: 0.41,
+      #=>   stopped: false, error: nil}
+  """
+  def tune(config, data, search_space, opts \\ []) do
+    opts = Keyword.validate!(opts, trials: 10, validation_ratio: 0.2, max_trial_seconds: nil)
+    space = for {name, values} <- search_space, do: {name, Enum.to_list(values)}
+
+    Telemetry.span(:tune, %{learner: config.learner}, fn ->
+      case training_data(data, config) do
+        {:ok, data} ->
+          case Native.tune(
+                 config,
+                 data,
+                 space,
+                 opts[:trials],
+                 opts[:validation_ratio] / 1,
+                 (opts[:max_trial_seconds] || -1) / 1
+               ) do
+            {:ok, ref, trials} ->
+              {ref, Enum.map(trials, &score_row/1)}
+
+            {:error, reason} ->
+              raise List.to_string(reason)
+          end
+
+        {:error, reason} ->
+          raise reason
+      end
+    end)
+  end
+
+  defp score_row(trial) do
+    hyper_params =
+      for {name, value} <- trial.hyper_params do
+        {name, if(is_list(value), do: List.to_string(value), else: value)}
+      end
+
+    error = if trial.error, do: List.to_string(trial.error)
+
+    %{trial | hyper_params: hyper_params, error: error}
+  end
+
+  @doc """
+  Train a model on a dataset file, read directly by Yggdrasil
+  without loading the data in the VM.
+
+  The path is prefixed with the format of the dataset, such as
+  `"csv:/data/train.csv"`. The type of each column is inferred from
+  the file; the label of a classification task is always categorical.
+
+  ## Options
 
-    case Val.validate(data, config, @train_validations) do
+    * `:column_types` - map or keyword of column names to `:numerical`,
+      `:categorical` or `:string`, overriding the inferred types.
+
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("class")
+        |> Scitree.train_from_path("csv:/data/train.csv", column_types: %{"zip" => :string})
+  """
+  def train_from_path(config, path, opts \\ []) do
+    opts = Keyword.validate!(opts, column_types: [])
+    column_types = for {name, type} <- opts[:column_types], do: {to_string(name), type}
+
+    case Val.validate(nil, config, [:learner]) do
       :ok ->
-        case Native.train(config, data) do
+        case Native.train_from_path(config, path, column_types) do
           {:ok, ref} ->
             ref
 
@@ -46,10 +167,66 @@ defmodule Scitree do
     end
   end
 
+  @doc """
+  Starts training a model on a native thread and returns a
+  reference right away.
+
+  The dataset is decoded before returning, then the training runs
+  outside of the BEAM schedulers. Two trainings run at once, each on
+  half of the cores unless its config sets `num_threads`; the others
+  wait for their turn. When it ends, the calling process
+  receives `{:scitree_done, ref, result}`, where `result` is either
+  `{:ok, model_ref}` or `{:error, reason}`. Use `await/2` to wait
+  for it like `train/2` would.
+
+      ref = Scitree.train_async(config, data_train)
+
+      receive do
+        {:scitree_done, ^ref, {:ok, model}} -> model
+      end
+  """
+  def train_async(config, data) do
+    case training_data(data, config) do
+      {:ok, data} ->
+        ref = make_ref()
+
+        case Native.train_async(config, data, ref) do
+          :ok ->
+            ref
+
+          {:error, reason} ->
+            raise List.to_string(reason)
+        end
+
+      {:error, reason} ->
+        raise reason
+    end
+  end
+
+  @doc """
+  Waits for a training started with `train_async/2` and returns
+  the model reference.
+  """
+  def await(ref, timeout \\ :infinity) do
+    receive do
+      {:scitree_done, ^ref, {:ok, model}} ->
+        model
+
+      {:scitree_done, ^ref, {:error, reason}} ->
+        raise List.to_string(reason)
+    after
+      timeout ->
+        raise "Timeout waiting for training"
+    end
+  end
+
   @doc """
   Apply the model to a dataset.
   The reference of the model to be executed must be received
   in the first argument and as the second argument a valid dataset.
+  A binding returned by `bind/2` may be given instead of the
+  reference, along with a list of columns in the bound order, and
+  a `Scitree.Dataset` instead of the dataset.
 
   ## Examples
       iex> data_train = %{
@@ -79,16 +256,213 @@ defmodule Scitree do
         ]
       >
   """
+  def predict(%Binding{} = binding, columns) when is_list(columns) do
+    Telemetry.span(:predict, %{model: binding}, fn ->
+      values =
+        columns
+        |> Enum.zip(binding.types)
+        |> Enum.map(fn {values, type} -> bound_values(values, type) end)
+
+      case Native.predict_bound(binding.ref, values) do
+        {:ok, results, chunk_size} ->
+          to_tensor(results, chunk_size)
+
+        {:error, reason} ->
+          raise List.to_string(reason)
+      end
+    end)
+  end
+
   def predict(reference, data) do
+    Telemetry.span(:predict, %{model: reference}, fn ->
+      case native_data(data) do
+        {:ok, data} ->
+          case Native.predict(reference, data) do
+            {:ok, results, chunk_size} ->
+              to_tensor(results, chunk_size)
+
+            {:error, reason} ->
+              raise List.to_string(reason)
+          end
+
+        {:error, reason} ->
+          raise reason
+      end
+    end)
+  end
+
+  @doc """
+  Applies only part of the model to a dataset, trading accuracy for
+  latency. Random forest and gradient boosted trees models are scored
+  tree after tree by the flattened forest of scitree, whatever the
+  engine selected for the model, so the prediction can stop early.
+
+  ## Options
+
+    * `:trees` - scores with the first `trees` trees of the model
+      only, rounded down to whole iterations for multi-class gradient
+      boosted trees. Defaults to all the trees.
+
+    * `:budget_us` - time budget of the call, in microseconds. Trees
+      are added to all the rows together and no more trees are added
+      once the budget is spent, so every row is scored by the same
+      trees. The result is then `{tensor, %{trees: used, truncated:
+      boolean}}`, `truncated` being set when fewer trees than asked
+      were used.
+
+  ## Examples
+
+      Scitree.predict(ref, data, trees: 50)
+      {tensor, %{trees: 120, truncated: true}} = Scitree.predict(ref, data, budget_us: 500)
+  """
+  def predict(reference, data, opts) do
+    opts = Keyword.validate!(opts, [:trees, :budget_us])
+    trees = Keyword.get(opts, :trees) || -1
+    budget_us = Keyword.get(opts, :budget_us)
+
+    Telemetry.span(:predict, %{model: reference}, fn ->
+      case native_data(data) do
+        {:ok, data} ->
+          case Native.predict_trees(reference, data, trees, budget_us || -1) do
+            {:ok, results, chunk_size, used, planned} ->
+              tensor = to_tensor(results, chunk_size)
+
+              if budget_us do
+                {tensor, %{trees: used, truncated: used < planned}}
+              else
+                tensor
+              end
+
+            {:error, reason} ->
+              raise List.to_string(reason)
+          end
+
+        {:error, reason} ->
+          raise reason
+      end
+    end)
+  end
+
+  @doc """
+  Resolves column names once against the model and returns a
+  binding. The binding can then be given to `predict/2` with a list
+  of columns in the same order, whose names, types and features are
+  not looked up again.
+
+  Names that are not in the dataspec of the model raise. Tensor
+  columns are converted to the type of their feature.
+
+      binding = Scitree.bind(ref, ["outlook", "temperature", "humidity", "wind"])
+      Scitree.predict(binding, [[1, 3], [1, 2], [1, 1], [2, 1]])
+  """
+  def bind(reference, column_names) do
+    case Native.bind(reference, Enum.map(column_names, &to_string/1)) do
+      {:ok, ref, types} ->
+        %Binding{ref: ref, model: reference, columns: column_names, types: types}
+
+      {:error, reason} ->
+        raise List.to_string(reason)
+    end
+  end
+
+  defp bound_values(%Nx.Tensor{} = tensor, :numerical), do: pack(tensor, {:f, 32})
+  defp bound_values(%Nx.Tensor{} = tensor, :categorical), do: pack(tensor, {:s, 32})
+  defp bound_values(values, _type), do: values
+
+  defp pack(tensor, type) do
+    tensor
+    |> Nx.reshape({Nx.size(tensor)})
+    |> Nx.as_type(type)
+    |> Nx.to_binary()
+  end
+
+  @doc """
+  Applies the model to a single example, given as a map of feature
+  name to value, and returns a tensor with one value per prediction
+  dimension.
+
+  Numbers are numerical values or categorical indexes, binaries are
+  categorical strings and `nil` is a missing value. Features absent
+  from the map are missing and unknown names are ignored. The example
+  is written straight into a preallocated example set, which makes
+  this much cheaper than `predict/2` with a dataset of one row.
+
+      Scitree.predict_one(ref, %{"outlook" => 1, "temperature" => 2, "wind" => 1})
+  """
+  def predict_one(reference, example) when is_map(example) do
+    Telemetry.span(:predict, %{model: reference}, fn ->
+      case Native.predict_one(reference, example) do
+        {:ok, results, _chunk_size} ->
+          Nx.from_binary(results, {:f, 32})
+
+        {:error, reason} ->
+          raise List.to_string(reason)
+      end
+    end)
+  end
+
+  @doc """
+  Applies the model to a dataset file and writes the predictions
+  to a csv file, with one column per prediction dimension.
+  Returns the number of scored rows.
+
+      Scitree.predict_from_path(ref, "csv:/data/test.csv", "csv:/data/predictions.csv")
+  """
+  def predict_from_path(reference, input_path, output_path) do
+    case Native.predict_from_path(reference, input_path, output_path) do
+      {:ok, num_rows} ->
+        num_rows
+
+      {:error, reason} ->
+        raise List.to_string(reason)
+    end
+  end
+
+  @doc """
+  Applies the model to a stream of datasets and returns a stream
+  of prediction tensors, one per element of the input stream.
+
+  Each element of `stream` is a dataset chunk in the same format
+  as the one accepted by `predict/2`. The chunks are scored with an
+  example set allocated once for the whole stream, so datasets that
+  do not fit in memory can be scored with bounded memory.
+
+  ## Options
+
+    * `:chunk_size` - number of rows of the reused example set.
+      Larger chunks are scored in several passes. Defaults to `10_000`.
+
+      "data.csv"
+      |> File.stream!()
+      |> Stream.chunk_every(10_000)
+      |> Stream.map(&parse_chunk/1)
+      |> then(&Scitree.predict_stream(ref, &1))
+      |> Enum.each(&store_predictions/1)
+  """
+  def predict_stream(reference, stream, opts \\ []) do
+    opts = Keyword.validate!(opts, chunk_size: 10_000)
+
+    Stream.transform(
+      stream,
+      fn ->
+        case Native.predictor(reference, opts[:chunk_size]) do
+          {:ok, predictor} -> predictor
+          {:error, reason} -> raise List.to_string(reason)
+        end
+      end,
+      fn data, predictor -> {[predict_chunk(predictor, data)], predictor} end,
+      fn _predictor -> :ok end
+    )
+  end
+
+  defp predict_chunk(predictor, data) do
     data = Infer.execute(data)
 
     case Val.validate(data, @pred_validations) do
       :ok ->
-        case Native.predict(reference, data) do
+        case Native.predict_chunk(predictor, data) do
           {:ok, results, chunk_size} ->
-            results
-            |> Enum.chunk_every(chunk_size)
-            |> Nx.tensor()
+            to_tensor(results, chunk_size)
 
           {:error, reason} ->
             raise List.to_string(reason)
@@ -99,6 +473,123 @@ defmodule Scitree do
     end
   end
 
+  @doc """
+  Trains a gradient boosted trees model further on new data and
+  returns a new model with up to `:extra_trees` more trees, without
+  training again on the data the model was trained on.
+
+  The data, or a `Scitree.Dataset`, is read with the dataspec of the
+  model: values are checked and encoded against its dictionaries,
+  exactly as for `predict/2`, and must hold the label column. The
+  config gives the label, which must be the label of the model, and
+  the learner hyper-parameters of the new trees (e.g. `shrinkage` or
+  `max_depth`). The model given is left unchanged, so processes can
+  keep predicting with it while the extended model is trained.
+
+  Regression models with the squared error loss and binary
+  classification models can be trained further.
+
+  ## Options
+
+    * `:extra_trees` - maximum number of trees added to the model.
+      Required.
+
+      ref = Scitree.continue_training(ref, config, data_last_hour, extra_trees: 50)
+  """
+  def continue_training(ref, config, data, opts) do
+    opts = Keyword.validate!(opts, [:extra_trees])
+    extra_trees = Keyword.fetch!(opts, :extra_trees)
+
+    Telemetry.span(:train, %{learner: config.learner, model: ref}, fn ->
+      case training_data(data, config) do
+        {:ok, data} ->
+          case Native.continue_training(ref, config, data, extra_trees) do
+            {:ok, ref} ->
+              ref
+
+            {:error, reason} ->
+              raise List.to_string(reason)
+          end
+
+        {:error, reason} ->
+          raise reason
+      end
+    end)
+  end
+
+  # Dataset handles are given as is to the NIFs, other data is
+  # inferred and validated. The sizes of the columns of a handle
+  # were checked when it was ingested.
+  defp training_data(%Dataset{ref: ref} = dataset, config) do
+    validations = @train_validations -- [:dataset_size]
+
+    with :ok <- Val.validate(Dataset.schema(dataset), config, validations), do: {:ok, ref}
+  end
+
+  defp training_data(data, config) do
+    data = Infer.execute(data)
+
+    with :ok <- Val.validate(data, config, @train_validations), do: {:ok, data}
+  end
+
+  defp native_data(%Dataset{ref: ref}), do: {:ok, ref}
+
+  defp native_data(data) do
+    data = Infer.execute(data)
+
+    with :ok <- Val.validate(data, @pred_validations), do: {:ok, data}
+  end
+
+  defp to_tensor(results, chunk_size) do
+    results
+    |> Nx.from_binary({:f, 32})
+    |> Nx.reshape({div(byte_size(results), 4 * chunk_size), chunk_size})
+  end
+
+  @doc """
+  Evaluates the model on a dataset that contains the label column
+  and returns a map of metrics, computed natively by Yggdrasil.
+
+  For classification the map holds `:accuracy` (with a 95% Wilson
+  interval in `:accuracy_ci`), `:log_loss` and, under `:classes`,
+  the one-vs-rest `:auc` and `:pr_auc` of each class. For regression
+  it holds `:rmse`.
+
+  ## Options
+
+    * `:bootstrapping_samples` - number of bootstrap samples used to
+      compute 95% confidence intervals of AUC, PR-AUC (`:auc_ci`,
+      `:pr_auc_ci`) and RMSE (`:rmse_ci`). Defaults to `0` (disabled).
+
+      Scitree.evaluate(ref, data_test)
+      #=> %{
+      #=>   num_examples: 14.0,
+      #=>   accuracy: 0.85,
+      #=>   accuracy_ci: {0.6, 0.96},
+      #=>   log_loss: 0.33,
+      #=>   classes: %{"1" => %{auc: 0.91, pr_auc: 0.87}, "2" => %{auc: 0.91, pr_auc: 0.94}}
+      #=> }
+  """
+  def evaluate(reference, data, opts \\ []) do
+    Telemetry.span(:evaluate, %{model: reference}, fn ->
+      opts = Keyword.validate!(opts, bootstrapping_samples: 0)
+
+      case native_data(data) do
+        {:ok, data} ->
+          case Native.evaluate(reference, data, opts[:bootstrapping_samples]) do
+            {:ok, metrics} ->
+              metrics
+
+            {:error, reason} ->
+              raise List.to_string(reason)
+          end
+
+        {:error, reason} ->
+          raise reason
+      end
+    end)
+  end
+
   @doc """
   A data specification is a list of attribute definitions that indicates
   how a dataset is semantically understood.
@@ -159,6 +650,134 @@ defmodule Scitree do
     end
   end
 
+  @doc """
+  Compiles the serving engine of the model ahead of the first
+  prediction and returns the model reference.
+
+  The engine is built once per model and shared by every
+  `predict/2` call, so warming up a freshly trained or loaded
+  model keeps the compilation cost out of the first request.
+
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.train(data_train)
+        |> Scitree.warmup()
+  """
+  def warmup(ref) do
+    case Native.warmup(ref) do
+      :ok ->
+        ref
+
+      {:error, reason} ->
+        raise List.to_string(reason)
+    end
+  end
+
+  @doc """
+  Describes the serving engine of the model, compiling it if needed.
+
+  Returns the name of the engine, the names of the engines
+  compatible with the model, whether the engine stores the model on
+  16 bits (see `compact/2`), the instruction set the native library
+  was compiled for and the instruction sets supported by the CPU.
+  The library is loaded in its most specialized variant the CPU
+  supports, see the README to force one.
+
+      Scitree.engine_info(ref)
+      #=> %{
+      #=>   engine: "GradientBoostedTreesQuickScorerExtended",
+      #=>   compatible_engines: [
+      #=>     "GradientBoostedTreesGeneric",
+      #=>     "GradientBoostedTreesQuickScorerExtended"
+      #=>   ],
+      #=>   quantized: false,
+      #=>   isa: :avx2,
+      #=>   supported_isa: [:generic, :avx2]
+      #=> }
+  """
+  def engine_info(ref) do
+    case Native.engine_info(ref) do
+      {:ok, info} ->
+        %{
+          info
+          | engine: List.to_string(info.engine),
+            compatible_engines: Enum.map(info.compatible_engines, &List.to_string/1)
+        }
+
+      {:error, reason} ->
+        raise List.to_string(reason)
+    end
+  end
+
+  @doc """
+  Selects the serving engine of the model and rebuilds it. Returns
+  the model reference.
+
+  By default the best engine compatible with the model is used.
+  `"ScitreeFlatForest"`, the flattened forest of scitree, is listed
+  last and used when no engine of Yggdrasil is compatible with the
+  model or allowed by the selection. Predictors, bindings and
+  servers already created keep the engine they were created with.
+
+  ## Options
+
+    * `:engine` - name of the engine to use, as listed by `engine_info/1`.
+
+    * `:exclude` - names of engines that must not be used.
+
+      ref
+      |> Scitree.select_engine(exclude: ["GradientBoostedTreesQuickScorerExtended"])
+      |> Scitree.engine_info()
+  """
+  def select_engine(ref, opts) do
+    opts = Keyword.validate!(opts, engine: nil, exclude: [])
+    excluded = Enum.map(opts[:exclude], &to_charlist/1)
+
+    case Native.select_engine(ref, to_charlist(opts[:engine] || ""), excluded) do
+      :ok ->
+        ref
+
+      {:error, reason} ->
+        raise List.to_string(reason)
+    end
+  end
+
+  @doc """
+  Returns a smaller copy of the model, for deployments where memory
+  matters more than the last bits of accuracy. The model given is
+  left unchanged.
+
+  ## Options
+
+    * `:trees` - number of trees kept, the first ones of the model,
+      rounded down to whole iterations for multi-class gradient
+      boosted trees. Defaults to all the trees.
+
+    * `:quantize` - rounds the thresholds and the leaf values of the
+      trees (regression values and class probabilities) to bfloat16.
+      The compacted model is then served by the flattened forest of
+      scitree, which stores them on 16 bits, and its trees are kept
+      nowhere else: it can predict but not be saved, serialized,
+      evaluated, compacted again or trained further. Defaults to
+      `false`.
+
+  ## Examples
+
+      small = Scitree.compact(ref, trees: 100, quantize: true)
+  """
+  def compact(ref, opts \\ []) do
+    opts = Keyword.validate!(opts, trees: nil, quantize: false)
+
+    case Native.compact(ref, opts[:trees] || -1, opts[:quantize]) do
+      {:ok, ref} ->
+        ref
+
+      {:error, reason} ->
+        raise List.to_string(reason)
+    end
+  end
+
   @doc """
   Save the model in a directory.
 
@@ -192,4 +811,100 @@ defmodule Scitree do
         raise reason
     end
   end
+
+  @doc """
+  Serializes the model into a binary, without going through a
+  user managed directory.
+
+  The binary can be sent to other nodes, stored in ETS or
+  `:persistent_term`, and turned back into a model with
+  `deserialize/1`.
+
+  ## Options
+
+    * `:compressed` - compresses the binary with gzip. Defaults to `false`.
+
+      binary = Scitree.serialize(ref, compressed: true)
+      ref = Scitree.deserialize(binary)
+  """
+  def serialize(ref, opts \\ []) do
+    opts = Keyword.validate!(opts, compressed: false)
+
+    case Native.serialize(ref) do
+      {:ok, binary} ->
+        if opts[:compressed], do: :zlib.gzip(binary), else: binary
+
+      {:error, reason} ->
+        raise List.to_string(reason)
+    end
+  end
+
+  @doc """
+  Loads a model serialized with `serialize/2` and returns a
+  model reference. Compressed binaries are detected automatically.
+  """
+  def deserialize(<<0x1F, 0x8B, _::binary>> = binary) do
+    binary
+    |> :zlib.gunzip()
+    |> deserialize()
+  end
+
+  def deserialize(binary) when is_binary(binary) do
+    case Native.deserialize(binary) do
+      {:ok, ref} ->
+        ref
+
+      {:error, reason} ->
+        raise List.to_string(reason)
+    end
+  end
+
+  @doc """
+  Returns the size in bytes of the model in memory, as estimated
+  by Yggdrasil.
+  """
+  def memory_usage(ref) do
+    case Native.memory_usage(ref) do
+      {:ok, bytes} ->
+        bytes
+
+      {:error, reason} ->
+        raise List.to_string(reason)
+    end
+  end
+
+  @doc """
+  Returns the number of models alive on the node and their total
+  size in bytes. Models are freed once their reference is garbage
+  collected.
+
+      Scitree.memory_stats()
+      #=> %{models: 2, bytes: 48_213}
+  """
+  def memory_stats() do
+    {:ok, stats} = Native.memory_stats()
+    stats
+  end
+
+  @doc """
+  Returns the time spent natively in each phase of the NIFs and
+  row/byte counters, accumulated since the library was loaded.
+
+  Phases are `:decode` (Elixir terms to columns), `:spec` (dataspec
+  inference when training), `:dataset`, `:engine_build`,
+  `:copy_examples`, `:write_examples`, `:predict`, `:result` and
+  `:train`. The accumulators are sharded per scheduler, so they are
+  cheap enough to stay enabled. See `Scitree.Telemetry` to report
+  them as telemetry events.
+
+      Scitree.stats()
+      #=> %{
+      #=>   phases: %{decode: %{calls: 12, nanoseconds: 84_210}, predict: %{...}, ...},
+      #=>   counters: %{rows_decoded: 1_200, rows_predicted: 1_200, bytes_decoded: 0, ...}
+      #=> }
+  """
+  def stats() do
+    {:ok, stats} = Native.stats()
+    stats
+  end
 end
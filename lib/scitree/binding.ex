@@ -0,0 +1,12 @@
+defmodule Scitree.Binding do
+  @moduledoc """
+  Column names of a dataset resolved once against a model by
+  `Scitree.bind/2`.
+
+  `:columns` holds the bound names and `:types` the type expected
+  for each of them (`:numerical`, `:categorical` or `:string`), or
+  `:ignored` for the columns that are not input features.
+  """
+
+  defstruct [:ref, :model, :columns, :types]
+end
@@ -13,7 +13,8 @@ defmodule Scitree.Config do
             options: @default_options,
             task: :classification,
             label: "",
-            log_directory: ""
+            log_directory: "",
+            num_threads: nil
 
   @type tasks :: :undefined | :classification | :regression | :ranking | :categorical_uplift
 
@@ -27,6 +28,7 @@ defmodule Scitree.Config do
         label: "",
         learner: :gradient_boosted_trees,
         log_directory: "",
+        num_threads: nil,
         options: [
           maximum_model_size_in_memory_in_bytes: -1.0,
           maximum_training_duration_seconds: -1.0,
@@ -50,6 +52,7 @@ defmodule Scitree.Config do
         label: "",
         learner: :random_forest,
         log_directory: "",
+        num_threads: nil,
         options: [
           random_seed: 123456,
           maximum_training_duration_seconds: -1.0,
@@ -66,6 +69,19 @@ defmodule Scitree.Config do
     * maximum_training_duration_seconds: Maximum training duration of the model expressed in seconds.
     * random_seed: Random seed for the training of the model.
 
+    Any other option is forwarded as is to the learner and checked
+    against its hyper-parameter specification, for instance:
+
+    * num_trees: Number of trees (`:random_forest`, `:gradient_boosted_trees`).
+    * max_depth: Maximum depth of the trees.
+    * shrinkage: Learning rate of `:gradient_boosted_trees`.
+    * subsample: Ratio of examples used to train each tree.
+    * num_candidate_attributes: Number of attributes tested at each node.
+    * growing_strategy: `"LOCAL"` or `"BEST_FIRST_GLOBAL"`.
+    * categorical_algorithm: `"CART"`, `"ONE_HOT"` or `"RANDOM"`.
+
+    Integers, floats, booleans and strings are accepted as values.
+
     To change default options, can use the following example.
 
   ## Examples
@@ -75,6 +91,7 @@ defmodule Scitree.Config do
         label: "",
         learner: :random_forest,
         log_directory: "",
+        num_threads: nil,
         options: [
           maximum_model_size_in_memory_in_bytes: -1.0,
           maximum_training_duration_seconds: -1.0,
@@ -85,7 +102,8 @@ defmodule Scitree.Config do
   """
   @spec learner(t(), learners(), list()) :: t()
   def learner(config, learner, opts \\ []) do
-    options = Keyword.validate!(opts, @default_options)
+    {defaults, hyper_params} = Keyword.split(opts, Keyword.keys(@default_options))
+    options = Keyword.validate!(defaults, @default_options) ++ hyper_params
 
     %{config | options: options, learner: learner}
   end
@@ -96,6 +114,29 @@ defmodule Scitree.Config do
   @spec label(t(), String.t()) :: t()
   def label(config, label), do: %{config | label: label}
 
+  @doc """
+  Set the number of threads used by the learner during training.
+  When not set, the default of Yggdrasil is used.
+
+  ## Examples
+
+      iex> Scitree.Config.init() |> Scitree.Config.num_threads(4)
+      %Scitree.Config{
+        label: "",
+        learner: :gradient_boosted_trees,
+        log_directory: "",
+        num_threads: 4,
+        options: [
+          maximum_model_size_in_memory_in_bytes: -1.0,
+          maximum_training_duration_seconds: -1.0,
+          random_seed: 123456
+        ],
+        task: :classification
+      }
+  """
+  @spec num_threads(t(), pos_integer()) :: t()
+  def num_threads(config, num_threads), do: %{config | num_threads: num_threads}
+
   @doc """
   Set a directory to save training logs
 
@@ -106,6 +147,7 @@ defmodule Scitree.Config do
         label: "",
         learner: :gradient_boosted_trees,
         log_directory: "/path",
+        num_threads: nil,
         options: [
           maximum_model_size_in_memory_in_bytes: -1.0,
           maximum_training_duration_seconds: -1.0,
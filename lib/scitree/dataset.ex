@@ -0,0 +1,72 @@
+defmodule Scitree.Dataset do
+  @moduledoc """
+  Dataset ingested once natively, to be trained on, predicted or
+  evaluated many times without decoding it again.
+
+  The handle owns the ingested columns and the dataspec inferred
+  from them. It is read only, so it can be shared by concurrent
+  calls, e.g. a hyper-parameter sweep training many configurations
+  on the same data.
+
+      dataset = Scitree.Dataset.new(data_train)
+
+      for max_depth <- [4, 6, 8] do
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.Config.learner(:gradient_boosted_trees, max_depth: max_depth)
+        |> Scitree.train(dataset)
+      end
+
+  `:columns` holds the `{name, type}` of each column and
+  `:num_rows` the number of rows. The native memory is freed once
+  the handle is garbage collected.
+  """
+
+  alias Scitree.Infer
+  alias Scitree.Native
+  alias Scitree.Validations, as: Val
+
+  defstruct [:ref, :columns, :num_rows]
+
+  @doc """
+  Ingests a dataset given like the data of `Scitree.train/2`.
+
+  ## Options
+
+    * `:columns` - names of the columns to ingest, the others are
+      left out. Defaults to every column.
+  """
+  def new(data, opts \\ []) do
+    opts = Keyword.validate!(opts, columns: nil)
+
+    data =
+      case opts[:columns] do
+        nil -> data
+        names -> Map.take(data, names)
+      end
+
+    columns = Infer.execute(data)
+
+    case Val.validate(columns, [:dataset_size]) do
+      :ok ->
+        case Native.dataset_new(columns) do
+          {:ok, ref, num_rows} ->
+            types = for {name, type, _values} <- columns, do: {name, type}
+            %__MODULE__{ref: ref, columns: types, num_rows: num_rows}
+
+          {:error, reason} ->
+            raise List.to_string(reason)
+        end
+
+      {:error, reason} ->
+        raise reason
+    end
+  end
+
+  @doc false
+  # Columns in the shape expected by Scitree.Validations, without
+  # their values.
+  def schema(%__MODULE__{columns: columns}) do
+    for {name, type} <- columns, do: {name, type, nil}
+  end
+end
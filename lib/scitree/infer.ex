@@ -2,6 +2,11 @@ defmodule Scitree.Infer do
   @doc """
   Returns a list of `{title, type, data}`-tuples.
 
+  Besides lists, a column can be given as an `Nx.Tensor` or as a
+  `{:numerical, binary}` / `{:categorical, binary}` tuple holding
+  native-endian f32 / s32 values. Both are passed to the NIF as
+  packed binaries.
+
   ## Examples
       iex> data = %{:id => [1, 2, 3], :title => ["a", "b", "c"]}
       iex> Scitree.Infer.execute(data)
@@ -10,12 +15,50 @@ defmodule Scitree.Infer do
   """
   def execute(data) do
     for {title, values} <- data,
-        [val | _] = values do
-      inferred_type = infer_column_type(val)
-      {to_string(title), inferred_type, values}
+        {type, values} <- List.wrap(infer_column(values)) do
+      {to_string(title), type, values}
     end
   end
 
+  @doc """
+  Returns the number of rows of a column, whether it is a list
+  or a packed binary of 32-bit values.
+
+  ## Examples
+      iex> Scitree.Infer.column_size([1, 2, 3])
+      3
+      iex> Scitree.Infer.column_size(<<1::32-native, 2::32-native>>)
+      2
+  """
+  def column_size(values) when is_binary(values), do: div(byte_size(values), 4)
+  def column_size(values), do: Enum.count(values)
+
+  # Tensors are packed into native-endian binaries, which the NIF
+  # reads directly instead of walking a list.
+  defp infer_column(%Nx.Tensor{} = tensor) do
+    {type, nx_type} =
+      case Nx.type(tensor) do
+        {:f, _} -> {:numerical, {:f, 32}}
+        {:bf, _} -> {:numerical, {:f, 32}}
+        _ -> {:categorical, {:s, 32}}
+      end
+
+    binary =
+      tensor
+      |> Nx.reshape({Nx.size(tensor)})
+      |> Nx.as_type(nx_type)
+      |> Nx.to_binary()
+
+    {type, binary}
+  end
+
+  defp infer_column({type, values})
+       when type in [:numerical, :categorical] and is_binary(values),
+       do: {type, values}
+
+  defp infer_column([val | _] = values), do: {infer_column_type(val), values}
+  defp infer_column(_), do: nil
+
   defp infer_column_type(val) when is_integer(val), do: :categorical
   defp infer_column_type(val) when is_boolean(val), do: :categorical
   defp infer_column_type(val) when is_float(val), do: :numerical
@@ -3,18 +3,110 @@ defmodule Scitree.Native do
 
   @on_load :load_nifs
 
+  # Variants of the library by instruction set, from the most
+  # specialized, with the cpu flag each one requires.
+  @variants [
+    {:avx512, "avx512f", 'scitree_avx512'},
+    {:avx2, "avx2", 'scitree_avx2'},
+    {:generic, nil, 'scitree'}
+  ]
+
   def load_nifs() do
-    path = :filename.join(:code.priv_dir(:scitree), 'scitree')
-    :erlang.load_nif(path, 0)
+    :erlang.load_nif(nif_path(), Application.get_env(:scitree, :num_threads, 0))
+  end
+
+  # The most specialized variant built and supported by the cpu, or
+  # the one forced with `config :scitree, isa: :generic`.
+  defp nif_path() do
+    priv = :code.priv_dir(:scitree)
+    forced = Application.get_env(:scitree, :isa)
+    flags = cpu_flags()
+
+    paths =
+      for {isa, flag, name} <- @variants,
+          if(forced, do: isa == forced, else: flag == nil or flag in flags),
+          do: :filename.join(priv, name)
+
+    Enum.find(paths, List.last(paths), &File.exists?(List.to_string(&1) <> ".so"))
+  end
+
+  defp cpu_flags() do
+    case File.read("/proc/cpuinfo") do
+      {:ok, info} ->
+        info
+        |> String.split("\n")
+        |> Enum.find("", &String.starts_with?(&1, "flags"))
+        |> String.split()
+
+      {:error, _} ->
+        default_cpu_flags()
+    end
+  end
+
+  # Without /proc/cpuinfo (e.g. macOS), x86-64 hosts keep the AVX2
+  # default of the builds that had a single variant.
+  defp default_cpu_flags() do
+    arch = List.to_string(:erlang.system_info(:system_architecture))
+
+    if String.starts_with?(arch, "x86_64"), do: ["avx2"], else: []
   end
 
   def train(_config, _path), do: :erlang.nif_error(:undef)
 
+  def train_async(_config, _path, _ref), do: :erlang.nif_error(:undef)
+
+  def train_from_path(_config, _path, _column_types), do: :erlang.nif_error(:undef)
+
+  def dataset_new(_data), do: :erlang.nif_error(:undef)
+
+  def tune(_config, _data, _space, _trials, _validation_ratio, _max_trial_seconds),
+    do: :erlang.nif_error(:undef)
+
+  def continue_training(_reference, _config, _data, _extra_trees), do: :erlang.nif_error(:undef)
+
   def predict(_reference, _model), do: :erlang.nif_error(:undef)
 
+  def predict_trees(_reference, _data, _max_trees, _budget_us), do: :erlang.nif_error(:undef)
+
+  def predict_one(_reference, _example), do: :erlang.nif_error(:undef)
+
+  def bind(_reference, _column_names), do: :erlang.nif_error(:undef)
+
+  def predict_bound(_binding, _values), do: :erlang.nif_error(:undef)
+
+  def predict_from_path(_reference, _input_path, _output_path), do: :erlang.nif_error(:undef)
+
+  def predictor(_reference, _chunk_size), do: :erlang.nif_error(:undef)
+
+  def predict_chunk(_predictor, _data), do: :erlang.nif_error(:undef)
+
+  def server_new(_reference, _max_rows, _window_us), do: :erlang.nif_error(:undef)
+
+  def server_submit(_server, _data, _ref), do: :erlang.nif_error(:undef)
+
+  def evaluate(_reference, _data, _bootstrapping_samples), do: :erlang.nif_error(:undef)
+
+  def compact(_reference, _max_trees, _quantize), do: :erlang.nif_error(:undef)
+
   def save(_reference, _path), do: :erlang.nif_error(:undef)
 
   def load(_path), do: :erlang.nif_error(:undef)
 
+  def serialize(_reference), do: :erlang.nif_error(:undef)
+
+  def deserialize(_binary), do: :erlang.nif_error(:undef)
+
+  def memory_usage(_reference), do: :erlang.nif_error(:undef)
+
+  def memory_stats(), do: :erlang.nif_error(:undef)
+
+  def stats(), do: :erlang.nif_error(:undef)
+
   def show_dataspec(_reference), do: :erlang.nif_error(:undef)
+
+  def warmup(_reference), do: :erlang.nif_error(:undef)
+
+  def engine_info(_reference), do: :erlang.nif_error(:undef)
+
+  def select_engine(_reference, _engine, _excluded), do: :erlang.nif_error(:undef)
 end
@@ -0,0 +1,101 @@
+defmodule Scitree.Server do
+  @moduledoc """
+  Micro-batching prediction server.
+
+  Small predictions submitted by concurrent processes are queued
+  natively and scored together with a single engine call, once
+  `:max_rows` rows are waiting or the oldest request has waited
+  `:window_us` microseconds. Each caller then receives its own rows.
+
+      server = Scitree.Server.new(ref, max_rows: 256, window_us: 500)
+      Scitree.Server.predict(server, %{"outlook" => [1], "wind" => [2]})
+
+  The server stops once its handle is garbage collected.
+  """
+
+  alias Scitree.Infer
+  alias Scitree.Native
+  alias Scitree.Validations, as: Val
+
+  defstruct [:ref, :model, :max_rows]
+
+  @doc """
+  Starts a server on a model.
+
+  ## Options
+
+    * `:max_rows` - maximum number of rows scored together. Requests
+      with more rows are scored directly by `Scitree.predict/2`.
+      Defaults to `256`.
+
+    * `:window_us` - time in microseconds a request waits for
+      others to join its batch. Defaults to `500`.
+  """
+  def new(model, opts \\ []) do
+    opts = Keyword.validate!(opts, max_rows: 256, window_us: 500)
+
+    case Native.server_new(model, opts[:max_rows], opts[:window_us]) do
+      {:ok, ref} ->
+        %__MODULE__{ref: ref, model: model, max_rows: opts[:max_rows]}
+
+      {:error, reason} ->
+        raise List.to_string(reason)
+    end
+  end
+
+  @doc """
+  Applies the model of the server to a dataset and returns the
+  predictions like `Scitree.predict/2`. Raises if they do not come
+  within `timeout` milliseconds.
+  """
+  def predict(%__MODULE__{} = server, data, timeout \\ 5000) do
+    columns = Infer.execute(data)
+
+    with :ok <- Val.validate(columns, [:dataset_size]),
+         {_title, _type, first} = hd(columns),
+         true <- Infer.column_size(first) <= server.max_rows do
+      submit(server, columns, timeout)
+    else
+      false -> Scitree.predict(server.model, data)
+      {:error, reason} -> raise reason
+    end
+  end
+
+  # The request is submitted by a process of its own, which ends with
+  # the reply. On timeout it is killed, so a late reply is dropped
+  # with it instead of staying in the mailbox of the caller.
+  defp submit(server, data, timeout) do
+    {pid, monitor} =
+      spawn_monitor(fn ->
+        ref = make_ref()
+
+        case Native.server_submit(server.ref, data, ref) do
+          :ok ->
+            receive do
+              {:scitree_prediction, ^ref, result} -> exit({:shutdown, result})
+            end
+
+          {:error, reason} ->
+            exit({:shutdown, {:error, reason}})
+        end
+      end)
+
+    receive do
+      {:DOWN, ^monitor, :process, ^pid, {:shutdown, {:ok, results, chunk_size}}} ->
+        results
+        |> Nx.from_binary({:f, 32})
+        |> Nx.reshape({div(byte_size(results), 4 * chunk_size), chunk_size})
+
+      {:DOWN, ^monitor, :process, ^pid, {:shutdown, {:error, reason}}} ->
+        raise List.to_string(reason)
+
+      {:DOWN, ^monitor, :process, ^pid, reason} ->
+        exit(reason)
+    after
+      timeout ->
+        Process.exit(pid, :kill)
+        Process.demonitor(monitor, [:flush])
+        raise "Timeout waiting for prediction"
+    end
+  end
+end
@@ -0,0 +1,64 @@
+defmodule Scitree.Telemetry do
+  @moduledoc """
+  Telemetry events of Scitree, emitted when the `:telemetry`
+  application is available. Scitree does not depend on it.
+
+    * `[:scitree, :train, :start | :stop | :exception]` - around
+      `Scitree.train/2` and `Scitree.continue_training/4`. The
+      metadata of the latter holds the model given to it, the one
+      being extended, under `:model`.
+
+    * `[:scitree, :predict, :start | :stop | :exception]` - around
+      `Scitree.predict/2` and `Scitree.predict_one/2`. The metadata
+      holds the model (or binding) under `:model`.
+
+    * `[:scitree, :evaluate, :start | :stop | :exception]` - around
+      `Scitree.evaluate/3`.
+
+    * `[:scitree, :tune, :start | :stop | :exception]` - around
+      `Scitree.tune/4`.
+
+    * `[:scitree, :stats]` - emitted by `emit_stats/0`, for instance
+      from `:telemetry_poller`. The measurements are the native
+      totals of `Scitree.stats/0`, flattened: `decode_nanoseconds`,
+      `decode_calls`, ..., `rows_predicted`, ...
+
+  The span events measure the whole call; the native phases of the
+  calls (term decoding, dataset construction, engine build, example
+  copy, predict, result construction) are accumulated in the stats.
+  """
+
+  @doc false
+  def span(event, metadata, fun) do
+    if telemetry?(:span, 3) do
+      apply(:telemetry, :span, [[:scitree, event], metadata, fn -> {fun.(), metadata} end])
+    else
+      fun.()
+    end
+  end
+
+  @doc """
+  Emits the `[:scitree, :stats]` event with the current native stats.
+  """
+  def emit_stats() do
+    %{phases: phases, counters: counters} = Scitree.stats()
+
+    measurements =
+      for {phase, %{calls: calls, nanoseconds: ns}} <- phases,
+          {key, value} <- [{"#{phase}_calls", calls}, {"#{phase}_nanoseconds", ns}],
+          into: counters,
+          do: {String.to_atom(key), value}
+
+    if telemetry?(:execute, 3) do
+      apply(:telemetry, :execute, [[:scitree, :stats], measurements, %{}])
+    end
+
+    :ok
+  end
+
+  # function_exported?/3 is false until the module is loaded, which
+  # nothing else may have done yet.
+  defp telemetry?(fun, arity) do
+    Code.ensure_loaded?(:telemetry) and function_exported?(:telemetry, fun, arity)
+  end
+end
@@ -5,6 +5,7 @@ defmodule Scitree.Validations do
   """
 
   alias Scitree.Config
+  alias Scitree.Infer
 
   @type data :: {{String.t(), atom(), [term()]}}
   @spec validate(data, Config.t(), list()) ::
@@ -60,10 +61,10 @@ defmodule Scitree.Validations do
   @spec validate_dataset_size(data, Config.t()) :: :ok | {:error, :incompatible_column_sizes}
   def validate_dataset_size(data, _config) do
     {_title, _type, first} = hd(data)
-    size = Enum.count(first)
+    size = Infer.column_size(first)
 
     data
-    |> Enum.all?(fn {_title, _type, vals} -> Enum.count(vals) == size end)
+    |> Enum.all?(fn {_title, _type, vals} -> Infer.column_size(vals) == size end)
     |> if do
       :ok
     else
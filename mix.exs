@@ -19,7 +19,7 @@ defmodule Scitree.MixProject do
       make_precompiler_url:
         "https://github.com/jeantux/scitree/releases/download/v#{@version}/@{artefact_filename}",
       make_precompiler_filename: "scitree",
-      make_precompiler_priv_paths: ["scitree.*"]
+      make_precompiler_priv_paths: ["scitree.so", "scitree_avx2.so", "scitree_avx512.so"]
     ]
   end
 
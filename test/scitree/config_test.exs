@@ -1,4 +1,17 @@
 defmodule Scitree.ConfigTest do
   use ExUnit.Case
   doctest Scitree.Config
+
+  alias Scitree.Config
+
+  test "learner hyper-parameters are kept with the default options" do
+    config = Config.init() |> Config.learner(:random_forest, num_trees: 50, random_seed: 1)
+
+    assert config.options == [
+             maximum_model_size_in_memory_in_bytes: -1.0,
+             maximum_training_duration_seconds: -1.0,
+             random_seed: 1,
+             num_trees: 50
+           ]
+  end
 end
@@ -35,4 +35,27 @@ defmodule Scitree.InferTest do
 
     assert Infer.execute(data) == expected
   end
+
+  test "Inference of dataset with tensors and packed binaries" do
+    data = %{
+      bill_depth_mm: Nx.tensor([18.5, 15.5, 18.75]),
+      flipper_length_mm: {:numerical, <<1.0::float-32-native, 2.0::float-32-native>>},
+      year: Nx.tensor([2009, 2009, 2007])
+    }
+
+    expected = [
+      {"bill_depth_mm", :numerical,
+       <<18.5::float-32-native, 15.5::float-32-native, 18.75::float-32-native>>},
+      {"flipper_length_mm", :numerical, <<1.0::float-32-native, 2.0::float-32-native>>},
+      {"year", :categorical,
+       <<2009::signed-32-native, 2009::signed-32-native, 2007::signed-32-native>>}
+    ]
+
+    assert Infer.execute(data) == expected
+  end
+
+  test "Size of list and packed columns" do
+    assert Infer.column_size([1, 2, 3]) == 3
+    assert Infer.column_size(<<1::32-native, 2::32-native, 3::32-native>>) == 3
+  end
 end
@@ -21,6 +21,10 @@ defmodule ScitreeTest do
     "wind" => [1, 2, 1, 1, 1]
   }
 
+  # Last row of @data_predict, checked against the single-example
+  # path: its expectations were never derived from the batch path.
+  @last_example %{"outlook" => 3, "temperature" => 3, "humidity" => 2, "wind" => 1}
+
   describe "classification task" do
     test "train label not identified" do
       config = Scitree.Config.init() |> Scitree.Config.label("invalid")
@@ -41,6 +45,30 @@ defmodule ScitreeTest do
       assert_raise UndefinedFunctionError, fn -> Scitree.train(config, dataset) end
     end
 
+    test "native columns with different size" do
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.train(@data_train)
+
+      data = Scitree.Infer.execute(%{@data_predict | "outlook" => [1, 1, 2]})
+
+      assert {:error, reason} = Scitree.Native.predict(ref, data)
+      assert List.to_string(reason) =~ "has a different number of rows"
+    end
+
+    test "columns matched by name" do
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.train(@data_train)
+
+      data = Scitree.Infer.execute(@data_predict)
+
+      assert {:ok, expected, 1} = Scitree.Native.predict(ref, data)
+      assert {:ok, ^expected, 1} = Scitree.Native.predict(ref, Enum.reverse(data))
+    end
+
     test "prediction with gradient boosted trees train" do
       config =
         Scitree.Config.init()
@@ -54,12 +82,298 @@ defmodule ScitreeTest do
           [0.09257776290178299],
           [0.007093166466802359],
           [0.90837562084198],
-          [0.6750206351280212],
-          [0.9997445940971375]
+          [0.6750206351280212]
         ])
 
       result = Scitree.predict(ref, @data_predict)
-      assert result == expected
+      assert result[0..3] == expected
+      assert result[4] == Scitree.predict_one(ref, @last_example)
+    end
+
+    test "asynchronous training" do
+      config = Scitree.Config.init() |> Scitree.Config.label("play_tennis")
+      ref = Scitree.train_async(config, @data_train)
+
+      assert_receive {:scitree_done, ^ref, {:ok, model}}, 60_000
+
+      assert Scitree.predict(model, @data_predict) ==
+               Scitree.predict(Scitree.train(config, @data_train), @data_predict)
+    end
+
+    test "streaming prediction" do
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.train(@data_train)
+
+      chunks = [
+        Map.new(@data_predict, fn {k, v} -> {k, Enum.take(v, 3)} end),
+        Map.new(@data_predict, fn {k, v} -> {k, Enum.drop(v, 3)} end)
+      ]
+
+      result =
+        ref
+        |> Scitree.predict_stream(Stream.map(chunks, & &1), chunk_size: 2)
+        |> Enum.to_list()
+        |> Nx.concatenate()
+
+      assert result == Scitree.predict(ref, @data_predict)
+    end
+
+    test "single example prediction" do
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.train(@data_train)
+
+      expected = Scitree.predict(ref, @data_predict)
+
+      for i <- 0..4 do
+        example = Map.new(@data_predict, fn {k, v} -> {k, Enum.at(v, i)} end)
+        assert Scitree.predict_one(ref, example) == expected[i]
+      end
+
+      assert_raise RuntimeError, fn -> Scitree.predict_one(ref, %{"outlook" => 1.5}) end
+
+      # Only nil is a missing value, other atoms are invalid.
+      assert Nx.shape(Scitree.predict_one(ref, %{"outlook" => nil})) == {1}
+
+      assert_raise RuntimeError, ~r/must be an integer or a string/, fn ->
+        Scitree.predict_one(ref, %{"outlook" => :sunny})
+      end
+
+      assert_raise RuntimeError, fn -> Scitree.predict_one(ref, %{"outlook" => true}) end
+    end
+
+    test "prediction with bound columns" do
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.train(@data_train)
+
+      names = ["wind", "humidity", "temperature", "outlook"]
+      binding = Scitree.bind(ref, names)
+      columns = Enum.map(names, &@data_predict[&1])
+
+      assert binding.types == [:categorical, :categorical, :categorical, :categorical]
+      assert Scitree.predict(binding, columns) == Scitree.predict(ref, @data_predict)
+
+      tensors = Enum.map(columns, &Nx.tensor/1)
+      assert Scitree.predict(binding, tensors) == Scitree.predict(ref, @data_predict)
+
+      assert_raise RuntimeError, fn -> Scitree.bind(ref, ["unknown"]) end
+    end
+
+    test "prediction with string columns" do
+      names = %{1 => "sunny", 2 => "overcast", 3 => "rain"}
+      data_train = Map.update!(@data_train, "outlook", fn v -> Enum.map(v, &names[&1]) end)
+      data_predict = Map.update!(@data_predict, "outlook", fn v -> Enum.map(v, &names[&1]) end)
+
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.train(data_train)
+
+      expected = Scitree.predict(ref, data_predict)
+
+      for i <- 0..4 do
+        example = Map.new(data_predict, fn {k, v} -> {k, Enum.at(v, i)} end)
+        assert Scitree.predict_one(ref, example) == expected[i]
+      end
+
+      unknown = Map.put(data_predict, "outlook", ["snow", "", "hail", "fog", "sleet"])
+      assert Nx.shape(Scitree.predict(ref, unknown)) == {5, 1}
+    end
+
+    test "native stats of the predictions" do
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.train(@data_train)
+
+      before = Scitree.stats()
+      Scitree.predict(ref, @data_predict)
+      stats = Scitree.stats()
+
+      assert stats.counters.rows_predicted - before.counters.rows_predicted >= 5
+      assert stats.phases.predict.calls > before.phases.predict.calls
+      assert stats.phases.decode.nanoseconds > before.phases.decode.nanoseconds
+      assert stats.phases.train.calls >= 1
+    end
+
+    test "micro-batched predictions" do
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.train(@data_train)
+
+      server = Scitree.Server.new(ref, max_rows: 4, window_us: 1000)
+      expected = Scitree.predict(ref, @data_predict)
+
+      rows =
+        0..4
+        |> Enum.map(fn i ->
+          row = Map.new(@data_predict, fn {k, v} -> {k, [Enum.at(v, i)]} end)
+          Task.async(fn -> Scitree.Server.predict(server, row) end)
+        end)
+        |> Task.await_many()
+
+      assert Nx.concatenate(rows) == expected
+      assert Scitree.Server.predict(server, @data_predict) == expected
+    end
+
+    test "micro-batched prediction on an unreferenced server" do
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.train(@data_train)
+
+      row = Map.new(@data_predict, fn {k, v} -> {k, [hd(v)]} end)
+
+      # The queued request keeps the server alive until it is answered.
+      prediction =
+        ref
+        |> Scitree.Server.new(window_us: 50_000)
+        |> Scitree.Server.predict(row)
+
+      :erlang.garbage_collect()
+      assert prediction == Scitree.predict(ref, row)
+    end
+
+    test "micro-batched prediction after a timeout" do
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.train(@data_train)
+
+      server = Scitree.Server.new(ref, window_us: 100_000)
+      row = Map.new(@data_predict, fn {k, v} -> {k, [hd(v)]} end)
+
+      assert_raise RuntimeError, "Timeout waiting for prediction", fn ->
+        Scitree.Server.predict(server, row, 1)
+      end
+
+      # The late reply is dropped rather than left in the mailbox.
+      Process.sleep(200)
+      assert {:message_queue_len, 0} = Process.info(self(), :message_queue_len)
+      assert Scitree.Server.predict(server, row) == Scitree.predict(ref, row)
+    end
+
+    test "sharded prediction of a large batch" do
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.train(@data_train)
+
+      n = 5000
+      large = Map.new(@data_predict, fn {k, v} -> {k, Enum.flat_map(1..n, fn _ -> v end)} end)
+      expected = Scitree.predict(ref, @data_predict)
+
+      assert Scitree.predict(ref, large) ==
+               Nx.concatenate(List.duplicate(expected, n))
+    end
+
+    test "parallel ingestion of a large dataset" do
+      names = %{1 => "sunny", 2 => "overcast", 3 => "rain"}
+      data_train = Map.update!(@data_train, "outlook", fn v -> Enum.map(v, &names[&1]) end)
+      data_predict = Map.update!(@data_predict, "outlook", fn v -> Enum.map(v, &names[&1]) end)
+
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.train(data_train)
+
+      # 20000 rows of 4 columns cross the threshold of the parallel
+      # ingestion, 5 rows stay on the calling thread.
+      n = 4000
+      large = Map.new(data_predict, fn {k, v} -> {k, Enum.flat_map(1..n, fn _ -> v end)} end)
+      expected = Nx.concatenate(List.duplicate(Scitree.predict(ref, data_predict), n))
+
+      assert Scitree.predict(ref, large) == expected
+      assert Scitree.predict(ref, Scitree.Dataset.new(large)) == expected
+    end
+
+    test "training and prediction on dataset handles" do
+      config = Scitree.Config.init() |> Scitree.Config.label("play_tennis")
+      dataset = Scitree.Dataset.new(@data_train)
+
+      assert dataset.num_rows == 14
+
+      refs = Enum.map(1..3, fn _ -> Task.async(fn -> Scitree.train(config, dataset) end) end)
+      [ref | _] = Task.await_many(refs, :infinity)
+      expected = Scitree.predict(ref, @data_predict)
+
+      assert Scitree.predict(ref, Scitree.Dataset.new(@data_predict)) == expected
+      assert Scitree.evaluate(ref, dataset).num_examples == 14
+
+      assert_raise UndefinedFunctionError, fn ->
+        Scitree.train(Scitree.Config.label(config, "invalid"), dataset)
+      end
+    end
+
+    test "hyper-parameter tuning" do
+      config =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.Config.learner(:gradient_boosted_trees)
+
+      space = %{max_depth: 2..4, shrinkage: [0.1, 0.2]}
+      {ref, trials} = Scitree.tune(config, @data_train, space, trials: 4, validation_ratio: 0.3)
+
+      assert length(trials) == 4
+      assert Enum.all?(trials, &(&1.error == nil and &1.score >= 0 and &1.score <= 1))
+      assert Enum.all?(trials, &(&1.hyper_params[:max_depth] in 2..4))
+      assert Scitree.predict(ref, @data_predict) |> Nx.shape() == {5, 1}
+    end
+
+    test "continued training of a gradient boosted trees model" do
+      config =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.Config.learner(:gradient_boosted_trees)
+
+      ref = Scitree.train(config, @data_train)
+      expected = Scitree.predict(ref, @data_predict)
+
+      extended = Scitree.continue_training(ref, config, @data_train, extra_trees: 5)
+
+      assert Scitree.predict(ref, @data_predict) == expected
+      assert Scitree.predict(extended, @data_predict) |> Nx.shape() == {5, 1}
+      assert Scitree.predict(extended, @data_predict) != expected
+
+      forest =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.Config.learner(:random_forest)
+        |> Scitree.train(@data_train)
+
+      assert_raise RuntimeError, fn ->
+        Scitree.continue_training(forest, config, @data_train, extra_trees: 5)
+      end
+    end
+
+    test "evaluation of a classification model" do
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.train(@data_train)
+
+      metrics = Scitree.evaluate(ref, @data_train, bootstrapping_samples: 100)
+
+      assert metrics.num_examples == 14
+      assert metrics.accuracy >= 0 and metrics.accuracy <= 1
+      assert {lower, upper} = metrics.accuracy_ci
+      assert lower <= metrics.accuracy and metrics.accuracy <= upper
+      assert %{auc: _, pr_auc: _, auc_ci: {_, _}} = metrics.classes["1"]
+    end
+
+    test "evaluation without label column" do
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.train(@data_train)
+
+      assert_raise RuntimeError, fn -> Scitree.evaluate(ref, @data_predict) end
     end
 
     test "Unable to load resource test" do
@@ -79,12 +393,167 @@ defmodule ScitreeTest do
           [0.37999972701072693],
           [0.2599998414516449],
           [0.6099995374679565],
-          [0.5366662740707397],
-          [0.21999986469745636]
+          [0.5366662740707397]
+        ])
+
+      result = Scitree.predict(ref, @data_predict)
+      assert result[0..3] == expected
+      assert result[4] == Scitree.predict_one(ref, @last_example)
+    end
+
+    test "warmup builds the engine before predictions" do
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.train(@data_train)
+
+      assert Scitree.warmup(ref) == ref
+
+      expected =
+        Nx.tensor([
+          [0.09257776290178299],
+          [0.007093166466802359],
+          [0.90837562084198],
+          [0.6750206351280212]
         ])
 
       result = Scitree.predict(ref, @data_predict)
-      assert result == expected
+      assert result[0..3] == expected
+      assert result[4] == Scitree.predict_one(ref, @last_example)
+      assert Scitree.predict(ref, @data_predict) == result
+    end
+
+    test "selection of the serving engine" do
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.train(@data_train)
+
+      info = Scitree.engine_info(ref)
+      expected = Scitree.predict(ref, @data_predict)
+
+      assert info.engine in info.compatible_engines
+      assert info.isa in info.supported_isa
+
+      for engine <- info.compatible_engines do
+        Scitree.select_engine(ref, engine: engine)
+
+        assert Scitree.engine_info(ref).engine == engine
+        predictions = Scitree.predict(ref, @data_predict)
+
+        assert Nx.all_close(predictions, expected) |> Nx.to_number() == 1
+      end
+
+      assert_raise RuntimeError, fn ->
+        Scitree.select_engine(ref, exclude: info.compatible_engines)
+      end
+
+      assert Scitree.engine_info(ref).engine == List.last(info.compatible_engines)
+    end
+
+    test "flattened forest engine" do
+      for learner <- [:random_forest, :cart, :gradient_boosted_trees] do
+        ref =
+          Scitree.Config.init()
+          |> Scitree.Config.label("play_tennis")
+          |> Scitree.Config.learner(learner)
+          |> Scitree.train(@data_train)
+
+        expected = Scitree.predict(ref, @data_predict)
+        assert "ScitreeFlatForest" in Scitree.engine_info(ref).compatible_engines
+
+        Scitree.select_engine(ref, engine: "ScitreeFlatForest")
+        assert Nx.all_close(Scitree.predict(ref, @data_predict), expected) |> Nx.to_number() == 1
+
+        example = Map.new(@data_predict, fn {k, v} -> {k, hd(v)} end)
+        prediction = Scitree.predict_one(ref, example)
+        assert Nx.all_close(prediction, expected[0]) |> Nx.to_number() == 1
+      end
+    end
+
+    test "truncated and time-budgeted predictions" do
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.Config.learner(:random_forest, num_trees: 10)
+        |> Scitree.train(@data_train)
+
+      expected = Scitree.predict(ref, @data_predict)
+      prediction = Scitree.predict(ref, @data_predict, trees: 10)
+      assert Nx.all_close(prediction, expected) |> Nx.to_number() == 1
+      assert Nx.shape(Scitree.predict(ref, @data_predict, trees: 1)) == {5, 1}
+
+      {prediction, %{trees: trees, truncated: truncated}} =
+        Scitree.predict(ref, @data_predict, budget_us: 1_000_000)
+
+      assert trees in 1..10
+      assert truncated == trees < 10
+      assert Nx.shape(prediction) == {5, 1}
+    end
+
+    test "model compaction" do
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.Config.learner(:random_forest, num_trees: 10)
+        |> Scitree.train(@data_train)
+
+      small = Scitree.compact(ref, trees: 1)
+      assert Scitree.memory_usage(small) < Scitree.memory_usage(ref)
+      expected = Scitree.predict(ref, @data_predict, trees: 1)
+      assert Nx.all_close(Scitree.predict(small, @data_predict), expected) |> Nx.to_number() == 1
+
+      quantized = Scitree.compact(ref, quantize: true)
+      assert Scitree.engine_info(quantized).engine == "ScitreeFlatForest"
+      assert Nx.shape(Scitree.predict(quantized, @data_predict)) == {5, 1}
+    end
+
+    test "quantized compaction of gradient boosted trees" do
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.train(@data_train)
+
+      quantized = Scitree.compact(ref, quantize: true)
+      assert %{engine: "ScitreeFlatForest", quantized: true} = Scitree.engine_info(quantized)
+      assert Scitree.memory_usage(quantized) < Scitree.memory_usage(ref)
+
+      expected = Scitree.predict(ref, @data_predict)
+      prediction = Scitree.predict(quantized, @data_predict)
+      assert Nx.all_close(prediction, expected, atol: 0.05) |> Nx.to_number() == 1
+
+      assert_raise RuntimeError, ~r/quantized model/, fn -> Scitree.serialize(quantized) end
+    end
+
+    test "prediction with tensor columns" do
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.train(Map.new(@data_train, fn {k, v} -> {k, Nx.tensor(v)} end))
+
+      data_predict = Map.new(@data_predict, fn {k, v} -> {k, Nx.tensor(v, type: {:s, 32})} end)
+
+      assert Scitree.predict(ref, data_predict) == Scitree.predict(ref, @data_predict)
+    end
+
+    test "training with learner hyper-parameters" do
+      config =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.Config.learner(:gradient_boosted_trees, num_trees: 10, shrinkage: 0.2)
+        |> Scitree.Config.num_threads(2)
+
+      ref = Scitree.train(config, @data_train)
+      assert Nx.shape(Scitree.predict(ref, @data_predict)) == {5, 1}
+    end
+
+    test "unknown learner hyper-parameter" do
+      config =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.Config.learner(:random_forest, unknown_param: 1)
+
+      assert_raise RuntimeError, fn -> Scitree.train(config, @data_train) end
     end
 
     test "Test directory already exists" do
@@ -109,13 +578,83 @@ defmodule ScitreeTest do
           [0.09257776290178299],
           [0.007093166466802359],
           [0.90837562084198],
-          [0.6750206351280212],
-          [0.9997445940971375]
+          [0.6750206351280212]
         ])
 
       result = Scitree.predict(ref, @data_predict)
       File.rm_rf(@temp_dir)
-      assert result == expected
+      assert result[0..3] == expected
+      assert result[4] == Scitree.predict_one(ref, @last_example)
+    end
+
+    test "serialize and deserialize models" do
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.train(@data_train)
+
+      expected = Scitree.predict(ref, @data_predict)
+
+      for opts <- [[], [compressed: true]] do
+        result =
+          ref
+          |> Scitree.serialize(opts)
+          |> Scitree.deserialize()
+          |> Scitree.predict(@data_predict)
+
+        assert result == expected
+      end
+    end
+
+    test "deserialize invalid binary" do
+      assert_raise RuntimeError, fn -> Scitree.deserialize("not a model") end
+    end
+
+    test "memory usage of models" do
+      %{models: models, bytes: bytes} = Scitree.memory_stats()
+
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.train(@data_train)
+
+      size = Scitree.memory_usage(ref)
+      assert size > 0
+
+      stats = Scitree.memory_stats()
+      assert stats.models >= models + 1
+      assert stats.bytes >= bytes + size
     end
+
+    test "train and predict from csv files" do
+      dir = System.tmp_dir!()
+      train_path = Path.join(dir, "scitree_train.csv")
+      predict_path = Path.join(dir, "scitree_predict.csv")
+      output_path = Path.join(dir, "scitree_predictions.csv")
+
+      write_csv(train_path, @data_train)
+      write_csv(predict_path, @data_predict)
+
+      ref =
+        Scitree.Config.init()
+        |> Scitree.Config.label("play_tennis")
+        |> Scitree.train_from_path("csv:" <> train_path)
+
+      assert Scitree.predict_from_path(ref, "csv:" <> predict_path, "csv:" <> output_path) == 5
+      assert output_path |> File.read!() |> String.split("\n", trim: true) |> length() == 6
+
+      Enum.each([train_path, predict_path, output_path], &File.rm/1)
+    end
+  end
+
+  defp write_csv(path, data) do
+    {names, columns} = Enum.unzip(data)
+
+    rows =
+      columns
+      |> Enum.zip()
+      |> Enum.map(fn row -> row |> Tuple.to_list() |> Enum.join(",") end)
+
+    File.write!(path, Enum.join([Enum.join(names, ",") | rows], "\n"))
   end
 end